@@ -0,0 +1,76 @@
+/**
+ * @file bench_http2.cpp
+ * @brief Time 1,000 concurrent small GET requests under each HttpVersion.
+ *
+ * Usage: bench_http2 <url> [requests = 1000]
+ *
+ * url must be served over HTTP/2, for example "https://localhost:8443/" of
+ * "nghttpd 8443 key.pem cert.pem" with its certificate trusted, which both HTTP/2 modes reach.
+ * An h2c URL such as "http://localhost:8080/" of "nghttpd --no-tls 8080" only serves
+ * Http2PriorKnowledge. A mode whose responses did not all
+ * arrive over HTTP/2 is reported as FAILED rather than timed, since its figure would measure
+ * HTTP/1.1.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <cstdio>
+
+#include "httpclient/httpclient.h"
+
+struct Mode {
+    const char *name;
+    HttpVersion version;
+    bool http2;  // every response must arrive over HTTP/2
+};
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QString url = app.arguments().value(1);
+    int count = app.arguments().value(2, "1000").toInt();
+    if (url.isEmpty()) {
+        std::printf("usage: bench_http2 <url of an HTTP/2 server> [requests = 1000]\n");
+        return 2;
+    }
+
+    std::printf("%d concurrent GET %s\n", count, qPrintable(url));
+    std::printf("%-20s %10s %8s %8s\n", "mode", "ms", "http2", "failed");
+
+    const Mode modes[] = {{"Http1Only", HttpVersion::Http1Only, false},
+                          {"Http2Preferred", HttpVersion::Http2Preferred, true},
+                          {"Http2PriorKnowledge", HttpVersion::Http2PriorKnowledge, true}};
+    int status = 0;
+    for (const Mode &mode : modes) {
+        HttpClient client;
+        ProtocolOptions options;
+        options.version = mode.version;
+        client.setProtocolOptions(options);
+
+        int pending = count;
+        int http2 = 0;
+        int failed = 0;
+        QEventLoop loop;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; i++) {
+            client.get(url, [&](const Response &response) {
+                http2 += response.http2 ? 1 : 0;
+                failed += response.ok() ? 0 : 1;
+                if (--pending == 0) {
+                    loop.quit();
+                }
+            });
+        }
+        loop.exec();
+        qint64 nsecs = timer.nsecsElapsed();
+
+        if (mode.http2 && (failed > 0 || http2 < count)) {
+            std::printf("%-20s FAILED: %d of %d responses over HTTP/2, %d failed\n", mode.name, http2, count, failed);
+            status = 1;
+            continue;
+        }
+        std::printf("%-20s %10.1f %8d %8d\n", mode.name, nsecs / 1e6, http2, failed);
+    }
+    return status;
+}
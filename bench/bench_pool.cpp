@@ -0,0 +1,81 @@
+/**
+ * @file bench_pool.cpp
+ * @brief Measure the throughput of HttpClientPool with requests issued from many threads.
+ *
+ * Usage: bench_pool [requests per worker = 2000]
+ *
+ * Each worker thread sends small GET requests one after another and waits for each result, so
+ * the number of workers is the number of requests in flight. The pool is measured with 1, 2 and
+ * 4 IO threads, next to a single HttpClient shared by the workers through get_sync.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "httpclient/httpclient.h"
+#include "httpclient/httpclientpool.h"
+#include "localserver.h"
+
+// Runs request count times on each of workers threads and returns the requests per second.
+static double measure(int workers, int count, const std::function<bool()> &request, std::atomic<int> *failures) {
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back([count, &request, failures]() {
+            for (int n = 0; n < count; n++) {
+                if (!request()) {
+                    (*failures)++;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return workers * count / (timer.nsecsElapsed() / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    int count = app.arguments().value(1, "2000").toInt();
+
+    LocalServer server;
+    QString url = server.url("/small");
+    std::atomic<int> failures{0};
+
+    std::printf("%-24s %8s %14s\n", "client", "workers", "requests/s");
+    for (int workers : {1, 4, 16, 64}) {
+        HttpClient client;
+        double rate = measure(workers, count, [&client, &url]() {
+            try {
+                client.get_sync(url);
+                return true;
+            } catch (const NetworkException &) {
+                return false;
+            }
+        }, &failures);
+        std::printf("%-24s %8d %14.0f\n", "HttpClient::get_sync", workers, rate);
+    }
+
+    for (int threads : {1, 2, 4}) {
+        for (int workers : {1, 4, 16, 64}) {
+            HttpClientPool pool(threads);
+            double rate = measure(workers, count, [&pool, &url]() { return pool.get(url).result().ok(); }, &failures);
+            QByteArray name = "HttpClientPool(" + QByteArray::number(threads) + ")";
+            std::printf("%-24s %8d %14.0f\n", name.constData(), workers, rate);
+        }
+    }
+
+    if (failures > 0) {
+        std::printf("%d requests failed\n", failures.load());
+        return 1;
+    }
+    return 0;
+}
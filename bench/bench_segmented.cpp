@@ -0,0 +1,79 @@
+/**
+ * @file bench_segmented.cpp
+ * @brief Time SegmentedDownloader against get_sync followed by writeFile.
+ *
+ * Usage: bench_segmented [size MiB = 64] [rate MiB/s per connection = 16]
+ *
+ * The local server paces each connection to the given rate, standing in for the per-connection
+ * TCP window limit that segmented downloads work around. A rate of 0 leaves the loopback
+ * unpaced, which measures the overhead of splitting the body.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <cstdio>
+
+#include "httpclient/httpclient.h"
+#include "httpclient/segmenteddownloader.h"
+#include "localserver.h"
+
+static constexpr qint64 mebibyte = 1024 * 1024;
+
+// Returns true if the file at path holds exactly expected.
+static bool matches(const QString &path, const QByteArray &expected) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) && file.readAll() == expected;
+}
+
+static void report(const char *name, qint64 nsecs, qint64 bytes) {
+    double seconds = nsecs / 1e9;
+    std::printf("%-28s %10.1f ms %10.1f MiB/s\n", name, nsecs / 1e6, bytes / double(mebibyte) / seconds);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments();
+    qint64 size = arguments.value(1, "64").toLongLong() * mebibyte;
+    qint64 rate = arguments.value(2, "16").toLongLong() * mebibyte;
+
+    LocalServer server(size, rate);
+    QTemporaryDir directory;
+    HttpClient client;
+    QString url = server.url("/blob");
+    std::printf("%lld MiB, %lld MiB/s per connection\n", size / mebibyte, rate / mebibyte);
+
+    try {
+        QString path = directory.filePath("single");
+        QElapsedTimer timer;
+        timer.start();
+        writeFile(path, client.get_sync(url));
+        qint64 nsecs = timer.nsecsElapsed();
+        if (!matches(path, server.blob())) {
+            std::printf("get_sync + writeFile wrote a different body\n");
+            return 1;
+        }
+        report("get_sync + writeFile", nsecs, size);
+
+        for (int connections : {1, 2, 4, SegmentedDownloader::maxHttp1Connections}) {
+            SegmentedDownloader downloader(&client);
+            downloader.setConnections(connections);
+            path = directory.filePath(QString("segmented-%1").arg(connections));
+
+            timer.start();
+            downloader.download_sync(url, path);
+            nsecs = timer.nsecsElapsed();
+            if (!matches(path, server.blob())) {
+                std::printf("SegmentedDownloader wrote a different body\n");
+                return 1;
+            }
+            QByteArray name = "segmented, " + QByteArray::number(connections) + " connections";
+            report(name.constData(), nsecs, size);
+        }
+    } catch (const NetworkException &e) {
+        std::printf("download failed: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
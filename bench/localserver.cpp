@@ -0,0 +1,211 @@
+#include "localserver.h"
+
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTimer>
+#include <memory>
+
+// Interval at which paced connections write their share of the rate.
+static constexpr int paceIntervalMsecs = 10;
+
+// Reason phrase of the status codes the handlers answer with.
+static QByteArray reasonPhrase(int statusCode) {
+    switch (statusCode) {
+        case 200:
+            return "OK";
+        case 206:
+            return "Partial Content";
+        case 304:
+            return "Not Modified";
+        case 401:
+            return "Unauthorized";
+        case 404:
+            return "Not Found";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Unknown";
+    }
+}
+
+LocalServer::LocalServer(qint64 blobSize, qint64 bytesPerSecond)
+    : server(new QTcpServer), body(blobSize, Qt::Uninitialized), rate(bytesPerSecond) {
+    // Random content, so a body assembled from the wrong ranges does not compare equal.
+    for (qsizetype i = 0; i < body.size(); i++) {
+        body[i] = char(QRandomGenerator::global()->generate());
+    }
+
+    thread.setObjectName("localserver");
+    server->moveToThread(&thread);
+    thread.start();
+
+    QMetaObject::invokeMethod(
+        server,
+        [this]() {
+            QObject::connect(server, &QTcpServer::newConnection, server, [this]() {
+                while (QTcpSocket *socket = server->nextPendingConnection()) {
+                    accepted++;
+                    serve(socket);
+                }
+            });
+            server->listen(QHostAddress::LocalHost);
+            port = server->serverPort();
+        },
+        Qt::BlockingQueuedConnection);
+}
+
+LocalServer::~LocalServer() {
+    // The sockets are children of the server and are destroyed with it on the thread.
+    server->deleteLater();
+    thread.quit();
+    thread.wait();
+}
+
+QString LocalServer::url(const QString &path) const {
+    return QString("http://127.0.0.1:%1%2").arg(port).arg(path);
+}
+
+const QByteArray &LocalServer::blob() const {
+    return body;
+}
+
+qint64 LocalServer::requests() const {
+    return answered.load();
+}
+
+qint64 LocalServer::connections() const {
+    return accepted.load();
+}
+
+void LocalServer::serve(QTcpSocket *socket) {
+    auto pending = std::make_shared<QByteArray>();   // request bytes not parsed yet
+    auto outgoing = std::make_shared<QByteArray>();  // response bytes held back by pacing
+    auto closing = std::make_shared<bool>(false);    // close once outgoing is written
+
+    QTimer *pacer = nullptr;
+    if (rate > 0) {
+        pacer = new QTimer(socket);
+        pacer->setInterval(paceIntervalMsecs);
+        QObject::connect(pacer, &QTimer::timeout, socket, [this, socket, outgoing, closing, pacer]() {
+            qint64 share = qMax<qint64>(rate * paceIntervalMsecs / 1000, 1);
+            socket->write(outgoing->left(share));
+            outgoing->remove(0, qMin<qint64>(share, outgoing->size()));
+            if (outgoing->isEmpty()) {
+                pacer->stop();
+                if (*closing) {
+                    socket->disconnectFromHost();
+                }
+            }
+        });
+    }
+
+    QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, pending, outgoing, closing, pacer]() {
+        pending->append(socket->readAll());
+        qsizetype end;
+        while (!*closing && (end = pending->indexOf("\r\n\r\n")) >= 0) {
+            QByteArray response = respond(pending->left(end), closing.get());
+            pending->remove(0, end + 4);
+            answered++;
+
+            if (!pacer) {
+                socket->write(response);
+                if (*closing) {
+                    socket->disconnectFromHost();
+                }
+                continue;
+            }
+            outgoing->append(response);
+            if (!pacer->isActive()) {
+                pacer->start();
+            }
+        }
+    });
+    QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+}
+
+QByteArray LocalServer::Request::header(const QByteArray &name) const {
+    for (const auto &header : headers) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+void LocalServer::handle(const QByteArray &path, Handler handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    handlers.insert(path, std::move(handler));
+}
+
+qint64 LocalServer::requests(const QByteArray &path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return answeredPaths.value(path);
+}
+
+QByteArray LocalServer::respond(const QByteArray &head, bool *close) {
+    QList<QByteArray> lines = head.split('\n');
+    QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+
+    Request request;
+    request.method = requestLine.value(0);
+    request.path = requestLine.value(1);
+    for (const QByteArray &line : lines.mid(1)) {
+        qsizetype colon = line.indexOf(':');
+        if (colon > 0) {
+            request.headers.append(qMakePair(line.left(colon).trimmed(), line.mid(colon + 1).trimmed()));
+        }
+    }
+
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handler = handlers.value(request.path);
+        answeredPaths[request.path]++;
+    }
+    Reply reply = handler ? handler(request) : builtIn(request);
+
+    QByteArray response =
+        "HTTP/1.1 " + QByteArray::number(reply.statusCode) + " " + reasonPhrase(reply.statusCode) + "\r\n";
+    for (const auto &header : reply.headers) {
+        response += header.first + ": " + header.second + "\r\n";
+    }
+    if (reply.statusCode != 304) {
+        response += "Content-Length: " + QByteArray::number(reply.body.size()) + "\r\n";
+    }
+    response += "\r\n";
+
+    if (request.method != "HEAD" && reply.statusCode != 304) {
+        response += reply.cutAfter >= 0 ? reply.body.left(reply.cutAfter) : reply.body;
+    }
+    *close = reply.cutAfter >= 0;
+    return response;
+}
+
+LocalServer::Reply LocalServer::builtIn(const Request &request) const {
+    Reply reply;
+    if (request.path != "/blob") {
+        reply.headers.append(qMakePair(QByteArray("Content-Type"), QByteArray("application/json")));
+        reply.body = "{\"ok\":true}";
+        return reply;
+    }
+
+    qint64 first = 0;
+    qint64 last = body.size() - 1;
+    QByteArray range = request.header("Range");
+    if (range.startsWith("bytes=")) {
+        QList<QByteArray> bounds = range.mid(6).split('-');
+        first = bounds.value(0).toLongLong();
+        if (!bounds.value(1).isEmpty()) {
+            last = qMin<qint64>(bounds.value(1).toLongLong(), body.size() - 1);
+        }
+        reply.statusCode = 206;
+        reply.headers.append(qMakePair(QByteArray("Content-Range"), "bytes " + QByteArray::number(first) + "-" +
+                                                                        QByteArray::number(last) + "/" +
+                                                                        QByteArray::number(body.size())));
+    }
+    reply.headers.append(qMakePair(QByteArray("Accept-Ranges"), QByteArray("bytes")));
+    reply.headers.append(qMakePair(QByteArray("ETag"), QByteArray("\"blob\"")));
+    reply.headers.append(qMakePair(QByteArray("Content-Type"), QByteArray("application/octet-stream")));
+    reply.body = body.mid(first, last - first + 1);
+    return reply;
+}
@@ -0,0 +1,153 @@
+#ifndef __LOCALSERVER_H__
+#define __LOCALSERVER_H__
+
+/**
+ * @file localserver.h
+ * @brief Minimal HTTP/1.1 server on the loopback interface that the benchmarks and the HttpClient
+ * tests run against.
+ */
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QTcpServer>
+#include <QThread>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+class QTcpSocket;
+
+/**
+ * @brief LocalServer answers GET and HEAD requests on 127.0.0.1 from a thread of its own, so
+ * clients blocking the main thread do not stall it. Connections are kept alive.
+ *
+ * "/blob" serves blobSize bytes with an ETag and honours "Range: bytes=first-last". Any other
+ * path serves a small JSON document, unless a Handler is installed for it. Request bodies are not
+ * supported.
+ *
+ * A positive bytes per second rate paces each connection separately, which stands in for the
+ * per-connection window limits of a remote server.
+ */
+class LocalServer {
+   public:
+    using Headers = QList<QPair<QByteArray, QByteArray>>;
+
+    /**
+     * @brief The request line and headers of a request.
+     */
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        Headers headers;
+
+        /**
+         * @brief Get the value of the header name, compared case-insensitively.
+         *
+         * @param name QByteArray
+         * @return QByteArray empty if the header is missing.
+         */
+        QByteArray header(const QByteArray &name) const;
+    };
+
+    /**
+     * @brief A response built by a Handler. Content-Length is added from body, except for 304.
+     */
+    struct Reply {
+        int statusCode = 200;
+        Headers headers;
+        QByteArray body;
+        qint64 cutAfter = -1;  // close the connection after this many bytes of body, -1 to send it all
+    };
+
+    /// Builds the response to a request. Runs on the thread of the server.
+    using Handler = std::function<Reply(const Request &request)>;
+
+    /**
+     * @brief Start listening on a free port.
+     *
+     * @param blobSize qint64 bytes served by "/blob"
+     * @param bytesPerSecond qint64 rate of each connection, 0 for unpaced
+     */
+    explicit LocalServer(qint64 blobSize = 0, qint64 bytesPerSecond = 0);
+
+    /**
+     * @brief Close all connections and stop the thread.
+     *
+     */
+    ~LocalServer();
+
+    LocalServer(const LocalServer &) = delete;
+    LocalServer &operator=(const LocalServer &) = delete;
+
+    /**
+     * @brief Get the URL of path on this server.
+     *
+     * @param path QString starting with "/"
+     * @return QString
+     */
+    QString url(const QString &path) const;
+
+    /**
+     * @brief Get the body served by "/blob".
+     *
+     * @return const QByteArray&
+     */
+    const QByteArray &blob() const;
+
+    /**
+     * @brief Get the number of requests answered so far.
+     *
+     * @return qint64
+     */
+    qint64 requests() const;
+
+    /**
+     * @brief Get the number of requests of path answered so far.
+     *
+     * @param path QByteArray
+     * @return qint64
+     */
+    qint64 requests(const QByteArray &path) const;
+
+    /**
+     * @brief Get the number of connections accepted so far.
+     *
+     * @return qint64
+     */
+    qint64 connections() const;
+
+    /**
+     * @brief Answer requests of path with handler instead of the built-in responses.
+     *
+     * @param path QByteArray
+     * @param handler Handler
+     */
+    void handle(const QByteArray &path, Handler handler);
+
+   private:
+    QThread thread;
+    QTcpServer *server;  // lives on thread
+    quint16 port = 0;
+    QByteArray body;
+    const qint64 rate;
+    std::atomic<qint64> answered{0};
+    std::atomic<qint64> accepted{0};
+    mutable std::mutex mutex;             // guards handlers and answeredPaths
+    QHash<QByteArray, Handler> handlers;  // by path
+    QHash<QByteArray, qint64> answeredPaths;
+
+    // Reads the requests of socket and queues their responses. Runs on thread.
+    void serve(QTcpSocket *socket);
+
+    // Builds the response to the request head and sets close if the connection must be closed
+    // after it. Runs on thread.
+    QByteArray respond(const QByteArray &head, bool *close);
+
+    // Builds the built-in response to request. Runs on thread.
+    Reply builtIn(const Request &request) const;
+};
+
+#endif /* __LOCALSERVER_H__ */
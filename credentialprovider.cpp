@@ -0,0 +1,156 @@
+#include "httpclient/credentialprovider.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QStringList>
+#include <QTimeZone>
+
+// QTimer takes an int interval, long lived tokens are re-checked at least once a day.
+static constexpr qint64 maxTimerInterval = 24 * 60 * 60 * 1000;
+
+// Scheduled refreshes are at least this many msecs apart, whatever the lifetime of new tokens.
+static constexpr qint64 minRefreshInterval = 10 * 1000;
+
+CredentialProvider::CredentialProvider(QObject *parent) : CredentialProvider(QString(), parent) {}
+
+CredentialProvider::CredentialProvider(const QString &token, QObject *parent) : QObject(parent), refreshTimer(this) {
+    refreshTimer.setSingleShot(true);
+    connect(&refreshTimer, &QTimer::timeout, this, &CredentialProvider::scheduleRefresh);
+    setToken(token);
+}
+
+void CredentialProvider::setToken(const QString &token) {
+    auto next = std::make_shared<Credentials>();
+    next->token = token;
+    if (!token.isEmpty()) {
+        next->authorization = std::make_shared<const QByteArray>("Bearer " + token.toLocal8Bit());
+    }
+    next->expiresAt = jwtExpiry(token);
+    std::atomic_store(&credentials, std::shared_ptr<const Credentials>(std::move(next)));
+
+    // The timer belongs to the provider's thread.
+    QMetaObject::invokeMethod(this, [this]() { scheduleRefresh(); }, Qt::QueuedConnection);
+    emit tokenChanged(token);
+}
+
+QString CredentialProvider::token() const {
+    return std::atomic_load(&credentials)->token;
+}
+
+std::shared_ptr<const QByteArray> CredentialProvider::authorization() const {
+    return std::atomic_load(&credentials)->authorization;
+}
+
+QDateTime CredentialProvider::expiresAt() const {
+    return std::atomic_load(&credentials)->expiresAt;
+}
+
+void CredentialProvider::setRefreshFunction(RefreshFunction refresh) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        refreshFunction = std::move(refresh);
+    }
+    scheduleRefresh();
+}
+
+void CredentialProvider::setRefreshMargin(std::chrono::seconds margin) {
+    refreshMargin = margin;
+    scheduleRefresh();
+}
+
+bool CredentialProvider::canRefresh() const {
+    return bool(refresher());
+}
+
+CredentialProvider::RefreshFunction CredentialProvider::refresher() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return refreshFunction;
+}
+
+void CredentialProvider::refresh(std::function<void(bool refreshed)> onRefreshed) {
+    QMetaObject::invokeMethod(
+        this,
+        [this, onRefreshed = std::move(onRefreshed)]() {
+            RefreshFunction function = refresher();
+            if (!function) {
+                if (onRefreshed) {
+                    onRefreshed(false);
+                }
+                return;
+            }
+
+            if (onRefreshed) {
+                waiters.append(onRefreshed);
+            }
+            if (refreshing) {
+                return;
+            }
+            refreshing = true;
+
+            QPointer<CredentialProvider> self(this);
+            function([self](const QString &token) {
+                if (self) {
+                    QMetaObject::invokeMethod(self.data(), [self, token]() { self->onRefreshed(token); }, Qt::QueuedConnection);
+                }
+            });
+        },
+        Qt::QueuedConnection);
+}
+
+void CredentialProvider::onRefreshed(const QString &token) {
+    refreshing = false;
+    QList<std::function<void(bool refreshed)>> pending;
+    pending.swap(waiters);
+
+    bool refreshed = !token.isEmpty();
+    if (refreshed) {
+        setToken(token);
+    } else {
+        emit refreshFailed();
+    }
+
+    for (const auto &onRefreshed : pending) {
+        onRefreshed(refreshed);
+    }
+}
+
+void CredentialProvider::scheduleRefresh() {
+    refreshTimer.stop();
+
+    QDateTime expiry = expiresAt();
+    if (!refresher() || !expiry.isValid()) {
+        return;
+    }
+
+    // A token living shorter than the margin is refreshed halfway through its lifetime, and
+    // never sooner than minRefreshInterval after the previous scheduled refresh, so that short
+    // lifetimes or clock skew can not make the refreshes loop.
+    qint64 remaining = QDateTime::currentDateTimeUtc().msecsTo(expiry);
+    qint64 delay = qMax(remaining - qint64(refreshMargin.count()) * 1000, remaining / 2);
+    if (lastRefresh.isValid()) {
+        delay = qMax(delay, minRefreshInterval - lastRefresh.elapsed());
+    }
+    if (delay <= 0) {
+        lastRefresh.start();
+        refresh();
+        return;
+    }
+
+    // Fires again here for tokens expiring later than the timer can wait.
+    refreshTimer.start(int(qMin(delay, maxTimerInterval)));
+}
+
+QDateTime CredentialProvider::jwtExpiry(const QString &token) {
+    QStringList parts = token.split('.');
+    if (parts.size() != 3) {
+        return QDateTime();
+    }
+
+    QByteArray payload = QByteArray::fromBase64(parts[1].toLatin1(), QByteArray::Base64UrlEncoding);
+    QJsonValue exp = QJsonDocument::fromJson(payload).object().value("exp");
+    if (!exp.isDouble()) {
+        return QDateTime();
+    }
+    return QDateTime::fromSecsSinceEpoch(qint64(exp.toDouble()), QTimeZone::utc());
+}
@@ -0,0 +1,289 @@
+#include "httpclient/diskcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimeZone>
+#include <algorithm>
+
+// Header names and values are bytes; Latin-1 maps them to JSON strings and back unchanged.
+static QJsonArray headersToJson(const QList<QPair<QByteArray, QByteArray>> &headers) {
+    QJsonArray array;
+    for (const auto &header : headers) {
+        QJsonArray pair;
+        pair.append(QString::fromLatin1(header.first));
+        pair.append(QString::fromLatin1(header.second));
+        array.append(pair);
+    }
+    return array;
+}
+
+static QList<QPair<QByteArray, QByteArray>> headersFromJson(const QJsonArray &array) {
+    QList<QPair<QByteArray, QByteArray>> headers;
+    for (const QJsonValue &value : array) {
+        QJsonArray pair = value.toArray();
+        headers.append(qMakePair(pair.at(0).toString().toLatin1(), pair.at(1).toString().toLatin1()));
+    }
+    return headers;
+}
+
+// Body files are named by the 64 hex digits of their SHA-256.
+static bool isBodyFileName(const QString &name) {
+    if (name.size() != 64) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](QChar c) {
+        return (c >= QChar('0') && c <= QChar('9')) || (c >= QChar('a') && c <= QChar('f'));
+    });
+}
+
+DiskCache::DiskCache(const QString &directory, qint64 maxBytes) : directory(directory), budget(maxBytes) {
+    QDir().mkpath(directory);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    open();
+}
+
+void DiskCache::setMaxBytes(qint64 bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict();
+    writeIndex();
+}
+
+qint64 DiskCache::maxBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+qint64 DiskCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+std::shared_ptr<CacheEntry> DiskCache::load(const QByteArray &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto record = records.find(key);
+    if (record == records.end()) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<CacheEntry>(record->entry);
+    if (!mapBody(record->hash, record->size, &entry->response)) {
+        erase(key);
+        writeIndex();
+        return nullptr;
+    }
+
+    // Recency is persisted with the next change of the index.
+    record->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    return entry;
+}
+
+bool DiskCache::save(const CacheEntry &entry) {
+    const QByteArray &body = entry.response.body;
+    QByteArray hash = QCryptographicHash::hash(body, QCryptographicHash::Sha256).toHex();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = records.find(entry.key);
+    if (existing != records.end() && existing->hash == hash) {
+        // The body is unchanged, as after a 304 Not Modified: only the metadata is replaced.
+        existing->entry = entry;
+        existing->entry.response.body.clear();
+        existing->entry.response.bodyStorage.reset();
+        existing->lastUsed = QDateTime::currentMSecsSinceEpoch();
+        return writeIndex();
+    }
+    if (existing != records.end()) {
+        erase(entry.key);
+    }
+    if (body.size() > budget) {
+        writeIndex();
+        return false;
+    }
+
+    // Content addressing: an identical body is already on disk and complete.
+    if (!references.contains(hash)) {
+        QSaveFile file(bodyPath(hash));
+        if (!file.open(QIODevice::WriteOnly) || file.write(body) != body.size() || !file.commit()) {
+            writeIndex();
+            return false;
+        }
+        bytes += body.size();
+    }
+
+    Record record;
+    record.entry = entry;
+    record.entry.response.body.clear();
+    record.entry.response.bodyStorage.reset();
+    record.hash = hash;
+    record.size = body.size();
+    record.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    records.insert(entry.key, record);
+    references[hash]++;
+
+    evict();
+    return writeIndex();
+}
+
+void DiskCache::remove(const QByteArray &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (records.contains(key)) {
+        erase(key);
+        writeIndex();
+    }
+}
+
+void DiskCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const QByteArray &key : records.keys()) {
+        erase(key);
+    }
+    writeIndex();
+}
+
+void DiskCache::open() {
+    QFile file(indexPath());
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonArray array = QJsonDocument::fromJson(file.readAll()).object().value("entries").toArray();
+        for (const QJsonValue &value : array) {
+            QJsonObject object = value.toObject();
+
+            Record record;
+            record.hash = object.value("hash").toString().toLatin1();
+            record.size = object.value("size").toInteger();
+            record.lastUsed = object.value("lastUsed").toInteger();
+
+            CacheEntry &entry = record.entry;
+            entry.key = object.value("key").toString().toLatin1();
+            entry.response.statusCode = object.value("status").toInt();
+            entry.response.reasonPhrase = object.value("reason").toString().toLatin1();
+            entry.response.rawHeaders = headersFromJson(object.value("headers").toArray());
+            entry.varyHeaders = headersFromJson(object.value("vary").toArray());
+            entry.credential = object.value("credential").toString().toLatin1();
+            entry.responseTime = QDateTime::fromMSecsSinceEpoch(object.value("responseTime").toInteger(), QTimeZone::utc());
+            entry.initialAge = object.value("initialAge").toInteger();
+            entry.freshnessLifetime = object.value("freshnessLifetime").toInteger();
+            entry.staleWhileRevalidate = object.value("staleWhileRevalidate").toInteger();
+            entry.staleIfError = object.value("staleIfError").toInteger();
+
+            // Drop entries whose body did not survive.
+            if (!isBodyFileName(QString::fromLatin1(record.hash)) || QFileInfo(bodyPath(record.hash)).size() != record.size) {
+                continue;
+            }
+            if (!references.contains(record.hash)) {
+                bytes += record.size;
+            }
+            references[record.hash]++;
+            records.insert(entry.key, record);
+        }
+    }
+
+    // Bodies written before a crash prevented the index from referring to them.
+    for (const QString &name : QDir(directory).entryList(QDir::Files)) {
+        if (isBodyFileName(name) && !references.contains(name.toLatin1())) {
+            QFile::remove(QDir(directory).filePath(name));
+        }
+    }
+
+    evict();
+}
+
+bool DiskCache::writeIndex() const {
+    QJsonArray array;
+    for (const Record &record : records) {
+        const CacheEntry &entry = record.entry;
+        QJsonObject object;
+        object.insert("key", QString::fromLatin1(entry.key));
+        object.insert("hash", QString::fromLatin1(record.hash));
+        object.insert("size", record.size);
+        object.insert("lastUsed", record.lastUsed);
+        object.insert("status", entry.response.statusCode);
+        object.insert("reason", QString::fromLatin1(entry.response.reasonPhrase));
+        object.insert("headers", headersToJson(entry.response.rawHeaders));
+        object.insert("vary", headersToJson(entry.varyHeaders));
+        object.insert("credential", QString::fromLatin1(entry.credential));
+        object.insert("responseTime", entry.responseTime.toMSecsSinceEpoch());
+        object.insert("initialAge", entry.initialAge);
+        object.insert("freshnessLifetime", entry.freshnessLifetime);
+        object.insert("staleWhileRevalidate", entry.staleWhileRevalidate);
+        object.insert("staleIfError", entry.staleIfError);
+        array.append(object);
+    }
+
+    QJsonObject index;
+    index.insert("entries", array);
+
+    QSaveFile file(indexPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(index).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void DiskCache::erase(const QByteArray &key) {
+    Record record = records.take(key);
+    if (--references[record.hash] > 0) {
+        return;
+    }
+    references.remove(record.hash);
+    bytes -= record.size;
+
+    // Responses still holding the mapping keep it alive; the cache forgets it either way.
+    mapped.remove(record.hash);
+
+    // A mapped body stays readable after its file is removed, except on Windows where the
+    // removal fails and the orphan is cleaned up when the cache is opened next.
+    QFile::remove(bodyPath(record.hash));
+}
+
+void DiskCache::evict() {
+    while (bytes > budget && !records.isEmpty()) {
+        auto oldest = std::min_element(records.begin(), records.end(),
+                                       [](const Record &a, const Record &b) { return a.lastUsed < b.lastUsed; });
+        erase(oldest.key());
+    }
+}
+
+bool DiskCache::mapBody(const QByteArray &hash, qint64 size, Response *response) {
+    if (size == 0) {
+        response->body = QByteArray();
+        response->bodyStorage.reset();
+        return true;
+    }
+
+    // Bodies are content-addressed, so a live mapping of hash is always current.
+    std::shared_ptr<Mapping> mapping = mapped.value(hash).lock();
+    if (!mapping) {
+        mapping = std::make_shared<Mapping>(bodyPath(hash));
+        if (!mapping->file.open(QIODevice::ReadOnly) || mapping->file.size() != size) {
+            mapped.remove(hash);
+            return false;
+        }
+        uchar *data = mapping->file.map(0, size);
+        if (!data) {
+            mapped.remove(hash);
+            return false;
+        }
+        mapping->body = QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+        mapped.insert(hash, mapping);
+    }
+
+    response->body = mapping->body;
+    response->bodyStorage = mapping;
+    return true;
+}
+
+QString DiskCache::bodyPath(const QByteArray &hash) const {
+    return QDir(directory).filePath(QString::fromLatin1(hash));
+}
+
+QString DiskCache::indexPath() const {
+    return QDir(directory).filePath("index.json");
+}
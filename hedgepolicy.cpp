@@ -0,0 +1,53 @@
+#include "httpclient/hedgepolicy.h"
+
+#include <algorithm>
+
+// Hedges that may accumulate while requests are fast, so a burst of slow ones can be hedged.
+static constexpr double maxHedgeTokens = 10;
+
+HedgeTracker::HedgeTracker(const HedgePolicy &policy) : options(policy) {
+    latencies.reserve(qMax(options.window, 1));
+}
+
+const HedgePolicy &HedgeTracker::policy() const {
+    return options;
+}
+
+void HedgeTracker::recordLatency(std::chrono::milliseconds latency) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (latencies.size() < qMax(options.window, 1)) {
+        latencies.append(latency.count());
+        return;
+    }
+    latencies[next] = latency.count();
+    next = (next + 1) % latencies.size();
+}
+
+std::chrono::milliseconds HedgeTracker::delay() const {
+    QList<qint64> samples;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latencies.size() < qMax(options.minSamples, 1)) {
+            return std::chrono::milliseconds(-1);
+        }
+        samples = latencies;
+    }
+
+    int rank = qBound(0, int(options.percentile * samples.size()), int(samples.size()) - 1);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return std::max(std::chrono::milliseconds(samples[rank]), options.minDelay);
+}
+
+void HedgeTracker::recordRequest() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tokens = qMin(tokens + options.maxHedgeRatio, maxHedgeTokens);
+}
+
+bool HedgeTracker::tryHedge() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tokens < 1) {
+        return false;
+    }
+    tokens -= 1;
+    return true;
+}
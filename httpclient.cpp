@@ -1,173 +1,1464 @@
 #include "httpclient/httpclient.h"
 
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QSaveFile>
+#include <QThread>
+#include <QTimer>
+#include <future>
+#include <limits>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD)
+#include <fcntl.h>
+#endif
+
+#include "httpclient/credentialprovider.h"
+#include "httpclient/hedgepolicy.h"
+#include "httpclient/networkthread.h"
+#include "httpclient/responsecache.h"
+#include "httpclient/retrypolicy.h"
+#include "httpclient/tlsprofile.h"
+#include "httpclient/tlssessioncache.h"
+#include "replyutil.h"
+
+namespace {
+
+// Progress of a resumable download, persisted next to the partial file.
+struct DownloadJournal {
+    QString url;
+    qint64 bytes = 0;  // bytes of the partial file known to be on disk
+    QByteArray etag;
+    QByteArray lastModified;
+};
+
+// State of a running resumable download.
+struct ResumableDownload {
+    QString path;
+    QFile file;
+    DownloadJournal journal;
+    qint64 journaledBytes = 0;  // journal.bytes when the journal was last written
+    QString error;              // set when the download is aborted by us
+};
+
+// The journal is rewritten at most once per this many bytes received.
+constexpr qint64 journalInterval = 1024 * 1024;
+
+QString partialPath(const QString &path) {
+    return path + ".part";
+}
+
+QString journalPath(const QString &path) {
+    return path + ".part.journal";
+}
+
+DownloadJournal readJournal(const QString &path) {
+    DownloadJournal journal;
+    QFile file(journalPath(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return journal;
+    }
+
+    QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    journal.url = object.value("url").toString();
+    journal.bytes = object.value("bytes").toInteger();
+    journal.etag = object.value("etag").toString().toUtf8();
+    journal.lastModified = object.value("lastModified").toString().toUtf8();
+    return journal;
+}
+
+// Flushes the partial file and atomically replaces the journal so that it never
+// claims more bytes than are on disk.
+void writeJournal(ResumableDownload *download) {
+    download->file.flush();
+
+    QJsonObject object;
+    object.insert("url", download->journal.url);
+    object.insert("bytes", download->journal.bytes);
+    object.insert("etag", QString::fromUtf8(download->journal.etag));
+    object.insert("lastModified", QString::fromUtf8(download->journal.lastModified));
+
+    QSaveFile file(journalPath(download->path));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+    download->journaledBytes = download->journal.bytes;
+}
+
+// Measures the phases of a reply from the moment it was created.
+struct TimingRecorder {
+    QElapsedTimer clock;
+    ResponseTiming timing;
+
+    ResponseTiming finish() {
+        ResponseTiming result = timing;
+        result.totalNsecs = clock.nsecsElapsed();
+        return result;
+    }
+};
+
+std::shared_ptr<TimingRecorder> recordTiming(QNetworkReply *reply) {
+    auto recorder = std::make_shared<TimingRecorder>();
+    recorder->clock.start();
+
+    QObject::connect(reply, &QNetworkReply::requestSent, reply, [recorder]() {
+        if (recorder->timing.requestSentNsecs < 0) {
+            recorder->timing.requestSentNsecs = recorder->clock.nsecsElapsed();
+        }
+    });
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, reply, [recorder]() {
+        if (recorder->timing.firstByteNsecs < 0) {
+            recorder->timing.firstByteNsecs = recorder->clock.nsecsElapsed();
+        }
+    });
+    return recorder;
+}
+
+// QTimer takes an int interval.
+constexpr qint64 maxTimerInterval = std::numeric_limits<int>::max();
+
+// Arms a timer on reply for each phase of the transfer and aborts the reply once a phase
+// exceeds its limit or the deadline passes. The returned string names the limit that aborted
+// the reply and stays empty otherwise.
+std::shared_ptr<QString> watchTimeouts(QNetworkReply *reply, const Timeouts &timeouts, const QDeadlineTimer &deadline) {
+    auto reason = std::make_shared<QString>();
+    if (timeouts.connect.count() <= 0 && timeouts.firstByte.count() <= 0 && timeouts.idle.count() <= 0 &&
+        deadline.isForever()) {
+        return reason;
+    }
+
+    auto timer = new QTimer(reply);
+    timer->setSingleShot(true);
+    auto phase = std::make_shared<QString>();
+
+    // Starts the limit of the next phase, or what is left until the deadline if that is sooner.
+    auto arm = [timer, phase, deadline](std::chrono::milliseconds limit, const char *name) {
+        qint64 remaining = deadline.remainingTime();
+        if (remaining >= 0 && (limit.count() <= 0 || remaining <= limit.count())) {
+            *phase = "Deadline exceeded";
+            timer->start(int(qMin(remaining, maxTimerInterval)));
+        } else if (limit.count() > 0) {
+            *phase = name;
+            timer->start(int(qMin<qint64>(limit.count(), maxTimerInterval)));
+        } else {
+            timer->stop();
+        }
+    };
+
+    QObject::connect(timer, &QTimer::timeout, reply, [reply, phase, reason]() {
+        *reason = *phase;
+        reply->abort();
+    });
+    // The connection is up once TLS is established or the first bytes of the body are written.
+    // An upload is then bounded by the idle limit between progress reports rather than by the
+    // connect limit, which would otherwise run until the whole body has been sent.
+    QObject::connect(reply, &QNetworkReply::encrypted, timer,
+                     [arm, timeouts]() { arm(timeouts.idle, "Idle timeout exceeded"); });
+    QObject::connect(reply, &QNetworkReply::uploadProgress, timer, [arm, timeouts](qint64 sent, qint64) {
+        if (sent > 0) {
+            arm(timeouts.idle, "Idle timeout exceeded");
+        }
+    });
+    QObject::connect(reply, &QNetworkReply::requestSent, timer,
+                     [arm, timeouts]() { arm(timeouts.firstByte, "First byte timeout exceeded"); });
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, timer,
+                     [arm, timeouts]() { arm(timeouts.idle, "Idle timeout exceeded"); });
+    QObject::connect(reply, &QNetworkReply::readyRead, timer,
+                     [arm, timeouts]() { arm(timeouts.idle, "Idle timeout exceeded"); });
+    QObject::connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
+
+    arm(timeouts.connect, "Connect timeout exceeded");
+    return reason;
+}
+
+// Limits of a request: those set in the request, the client's for the others.
+Timeouts mergeTimeouts(const Timeouts &request, const Timeouts &client) {
+    Timeouts merged = client;
+    if (request.connect.count() > 0) {
+        merged.connect = request.connect;
+    }
+    if (request.firstByte.count() > 0) {
+        merged.firstByte = request.firstByte;
+    }
+    if (request.idle.count() > 0) {
+        merged.idle = request.idle;
+    }
+    if (request.total.count() > 0) {
+        merged.total = request.total;
+    }
+    return merged;
+}
+
+// The sooner of deadline and the total timeout starting now.
+QDeadlineTimer effectiveDeadline(const QDeadlineTimer &deadline, std::chrono::milliseconds total) {
+    if (total.count() <= 0) {
+        return deadline;
+    }
+    QDeadlineTimer limit(qint64(total.count()));
+    return limit.deadline() < deadline.deadline() ? limit : deadline;
+}
+
+// Qt closes connections idle for 120 seconds, warm connections are reopened more often.
+constexpr std::chrono::seconds keepWarmInterval(60);
+
+// Stores the session ticket reply's connection received for host, if any.
+void storeSession(QNetworkReply *reply, TlsSessionCache *sessions, const QString &host) {
+    QSslConfiguration ssl = reply->sslConfiguration();
+    QByteArray ticket = ssl.sessionTicket();
+    if (!ticket.isEmpty()) {
+        sessions->store(host, ticket, ssl.sessionTicketLifeTimeHint());
+    }
+}
+
+// Counts the TLS handshake of the connection reply opens, if it opens one, and stores the
+// session the server issued for host.
+void watchHandshake(QNetworkReply *reply, TlsSessionCache *sessions, const QString &host, bool offered) {
+    auto clock = std::make_shared<QElapsedTimer>();
+    auto encrypted = std::make_shared<bool>(false);
+    clock->start();
+
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, reply, [clock]() { clock->start(); });
+    QObject::connect(reply, &QNetworkReply::encrypted, reply, [reply, sessions, host, offered, clock, encrypted]() {
+        *encrypted = true;
+        sessions->recordHandshake(offered, clock->nsecsElapsed());
+        storeSession(reply, sessions, host);
+    });
+    // TLS 1.3 servers send their tickets after the handshake.
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, sessions, host, encrypted]() {
+        if (*encrypted) {
+            storeSession(reply, sessions, host);
+        }
+    });
+}
+
+// Sends request with the given http method through manager.
+QNetworkReply *send(QNetworkAccessManager *manager, const QByteArray &method, const QNetworkRequest &request,
+                    const QByteArray &data) {
+    if (method == "GET") {
+        return manager->get(request);
+    } else if (method == "POST") {
+        return manager->post(request, data);
+    } else if (method == "PUT") {
+        return manager->put(request, data);
+    } else if (method == "DELETE") {
+        return manager->deleteResource(request);
+    } else if (method == "HEAD") {
+        return manager->head(request);
+    }
+    return manager->sendCustomRequest(request, method, data);
+}
+
+// Failures of the origin a stale response may stand in for (RFC 5861 4).
+bool isOriginError(const Response &response) {
+    switch (response.statusCode) {
+        case 0:
+            return response.error != QNetworkReply::NoError;
+        case 500:
+        case 502:
+        case 503:
+        case 504:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The body of response as a QByteArray owning its bytes. A body mapped by the DiskCache is
+// only valid while a Response holds its mapping, so it is copied before it leaves the library
+// on its own.
+QByteArray ownedBody(const Response &response) {
+    if (!response.bodyStorage) {
+        return response.body;
+    }
+    return QByteArray(response.body.constData(), response.body.size());
+}
+
+// Allocates length bytes on disk for file, so a full disk fails the download up front and the
+// body is written into contiguous blocks. Where posix_fallocate is missing the file is only
+// extended, which most filesystems do without allocating blocks.
+bool preallocate(QFileDevice *file, qint64 length) {
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD)
+    if (posix_fallocate(file->handle(), 0, length) == 0) {
+        return true;
+    }
+#endif
+    return file->resize(length);
+}
+
+}  // namespace
+
 HttpClient::HttpClient(QObject *parent) : QObject(parent), manager(new QNetworkAccessManager(this)){};
-HttpClient::HttpClient(QObject *parent, const QMap<QString, QString> &headers) : QObject(parent), headers(headers), manager(new QNetworkAccessManager(this)){};
+HttpClient::HttpClient(QObject *parent, const QMap<QString, QString> &headers) : QObject(parent), manager(new QNetworkAccessManager(this)), headers(headers) {
+    encodeHeaders();
+};
 HttpClient::~HttpClient() {
+    // Stop the network thread first: replies finishing there reach completeCall, which uses
+    // members that are destroyed after this body has run.
+    delete syncThread.exchange(nullptr);
     delete manager;
 }
 
 void HttpClient::setRootCA(QString certPath) {
     QFile file(certPath);
-
     if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Unable to load root certificate" << file.errorString();
+        qWarning() << "Unable to load root certificate" << file.errorString();
         return;
     }
 
-    const QByteArray bytes = file.readAll();
-    const QSslCertificate certificate(bytes);
+    // A bundle holds several certificates, all of them are trusted.
+    const QList<QSslCertificate> certificates = QSslCertificate::fromData(file.readAll(), QSsl::Pem);
+    if (certificates.isEmpty()) {
+        qWarning() << "No root certificate in" << certPath;
+        return;
+    }
 
     // Add custom ca to default ssl configuration
     QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
-    auto certs = configuration.caCertificates();
-    certs.append(certificate);
-
-    configuration.setCaCertificates(certs);
+    configuration.addCaCertificates(certificates);
     QSslConfiguration::setDefaultConfiguration(configuration);
-    file.close();
+}
+
+struct HttpClient::Tls {
+    TlsProfile profile;
+    QSslConfiguration configuration;
+};
+
+bool HttpClient::setTlsProfile(const TlsProfile &profile) {
+    std::shared_ptr<const Tls> settings = loadTls(profile);
+    if (!settings) {
+        return false;
+    }
+    std::atomic_store(&tls, settings);
+    return true;
+}
+
+std::shared_ptr<const HttpClient::Tls> HttpClient::loadTls(const TlsProfile &profile) {
+    QString error;
+    QSslConfiguration configuration = profile.toSslConfiguration(&error);
+    if (configuration.isNull()) {
+        qWarning() << "Unable to load TLS profile:" << error;
+        return nullptr;
+    }
+
+    auto settings = std::make_shared<Tls>();
+    settings->profile = profile;
+    settings->configuration = configuration;
+    return settings;
+}
+
+TlsProfile HttpClient::tlsProfile() const {
+    std::shared_ptr<const Tls> settings = std::atomic_load(&tls);
+    return settings ? settings->profile : TlsProfile();
 }
 
 void HttpClient::setBearerToken(const QString &jwtToken) {
-    HttpClient::token = jwtToken;
+    std::shared_ptr<const QByteArray> header;
+    if (!jwtToken.isEmpty()) {
+        header = std::make_shared<const QByteArray>("Bearer " + jwtToken.toLocal8Bit());
+    }
+    std::atomic_store(&HttpClient::tokenHeader, header);
 }
 
 // Initialize static token
-QString HttpClient::token = QString();
+std::shared_ptr<const QByteArray> HttpClient::tokenHeader;
+
+void HttpClient::setCredentialProvider(CredentialProvider *provider) {
+    credentials.store(provider);
+}
+
+CredentialProvider *HttpClient::credentialProvider() const {
+    return credentials.load();
+}
+
+void HttpClient::setRetryPolicy(const RetryPolicy &policy) {
+    std::atomic_store(&retryBudget, std::make_shared<RetryBudget>(policy.budgetTokens, policy.budgetRefill));
+    std::atomic_store(&retries, std::shared_ptr<const RetryPolicy>(std::make_shared<RetryPolicy>(policy)));
+}
+
+RetryPolicy HttpClient::retryPolicy() const {
+    std::shared_ptr<const RetryPolicy> policy = std::atomic_load(&retries);
+    return policy ? *policy : RetryPolicy();
+}
+
+void HttpClient::setHedgePolicy(const HedgePolicy &policy) {
+    std::shared_ptr<HedgeTracker> tracker;
+    if (policy.maxHedgeRatio > 0) {
+        tracker = std::make_shared<HedgeTracker>(policy);
+    }
+    std::atomic_store(&hedging, tracker);
+}
+
+HedgePolicy HttpClient::hedgePolicy() const {
+    std::shared_ptr<HedgeTracker> tracker = std::atomic_load(&hedging);
+    return tracker ? tracker->policy() : HedgePolicy();
+}
+
+void HttpClient::setCache(ResponseCache *cache) {
+    responseCache.store(cache);
+}
+
+ResponseCache *HttpClient::cache() const {
+    return responseCache.load();
+}
+
+void HttpClient::setTlsSessionCache(TlsSessionCache *sessions) {
+    sessionCache.store(sessions);
+}
+
+TlsSessionCache *HttpClient::tlsSessionCache() const {
+    return sessionCache.load();
+}
+
+void HttpClient::setCoalescing(bool enabled) {
+    coalesce.store(enabled);
+}
+
+bool HttpClient::coalescing() const {
+    return coalesce.load();
+}
+
+void HttpClient::setTimeouts(const Timeouts &timeouts) {
+    std::atomic_store(&limits, std::shared_ptr<const Timeouts>(std::make_shared<Timeouts>(timeouts)));
+}
+
+Timeouts HttpClient::timeouts() const {
+    return *std::atomic_load(&limits);
+}
+
+void HttpClient::setProtocolOptions(const ProtocolOptions &options) {
+    auto settings = std::make_shared<Protocol>();
+    settings->options = options;
+    if (options.sessionWindowSize > 0) {
+        settings->http2.setSessionReceiveWindowSize(options.sessionWindowSize);
+    }
+    if (options.streamWindowSize > 0) {
+        settings->http2.setStreamReceiveWindowSize(options.streamWindowSize);
+    }
+    if (options.maxFrameSize > 0) {
+        settings->http2.setMaxFrameSize(options.maxFrameSize);
+    }
+    std::atomic_store(&protocol, std::shared_ptr<const Protocol>(std::move(settings)));
+}
+
+ProtocolOptions HttpClient::protocolOptions() const {
+    return std::atomic_load(&protocol)->options;
+}
+
+void HttpClient::prewarm(const QStringList &origins, int connections) {
+    // The manager and the timer belong to the thread of the client.
+    QMetaObject::invokeMethod(this, [this, origins, connections]() {
+        for (const QString &origin : origins) {
+            QUrl url(origin);
+            url.setPort(url.port(url.scheme() == "https" ? 443 : 80));
+            QString key =
+                url.adjusted(QUrl::RemoveUserInfo | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment).toString();
+            if (connections > 0) {
+                warmOrigins.insert(key, connections);
+            } else {
+                warmOrigins.remove(key);
+            }
+        }
+
+        if (warmOrigins.isEmpty()) {
+            delete keepWarmTimer;
+            keepWarmTimer = nullptr;
+            return;
+        }
+        if (!keepWarmTimer) {
+            keepWarmTimer = new QTimer(this);
+            connect(keepWarmTimer, &QTimer::timeout, this, &HttpClient::warmConnections);
+            keepWarmTimer->start(keepWarmInterval);
+        }
+        warmConnections();
+    });
+}
+
+void HttpClient::warmConnections() {
+    std::shared_ptr<const Tls> profile = std::atomic_load(&tls);
+    QSslConfiguration ssl = profile ? profile->configuration : QSslConfiguration::defaultConfiguration();
+
+    // Without the ALPN protocols a TLS connection would be opened for HTTP/1.1 only.
+    if (std::atomic_load(&protocol)->options.version != HttpVersion::Http1Only) {
+        ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+    }
+
+    // Connections that are still open are reused by Qt, only closed ones are opened again.
+    for (auto it = warmOrigins.cbegin(); it != warmOrigins.cend(); ++it) {
+        QUrl origin(it.key());
+        for (int i = 0; i < it.value(); i++) {
+            if (origin.scheme() == "https") {
+                manager->connectToHostEncrypted(origin.host(), origin.port(443), ssl);
+            } else {
+                manager->connectToHost(origin.host(), origin.port(80));
+            }
+        }
+    }
+}
+
+void HttpClient::setDefaultHeader(const QString &name, const QString &value) {
+    std::lock_guard<std::mutex> lock(headersMutex);
+    headers.insert(name, value);
+    encodeHeaders();
+}
+
+void HttpClient::setDefaultHeaders(const QMap<QString, QString> &headers) {
+    std::lock_guard<std::mutex> lock(headersMutex);
+    this->headers = headers;
+    encodeHeaders();
+}
+
+QMap<QString, QString> HttpClient::defaultHeaders() const {
+    std::lock_guard<std::mutex> lock(headersMutex);
+    return headers;
+}
+
+void HttpClient::encodeHeaders() {
+    auto block = std::make_shared<HeaderBlock>();
+    block->reserve(headers.size());
+
+    QMapIterator<QString, QString> it(headers);
+    while (it.hasNext()) {
+        it.next();
+        block->append(qMakePair(it.key().toLocal8Bit(), it.value().toLocal8Bit()));
+    }
+    std::atomic_store(&encodedHeaders, std::shared_ptr<const HeaderBlock>(std::move(block)));
+}
 
 void HttpClient::get(const QString &url) noexcept {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->get(request);
-    connect(reply, &QNetworkReply::finished, this, &HttpClient::onReplyFinished);
+    get(url, [this](const Response &response) { emitResponse(response); });
 }
 
 void HttpClient::post(const QString &url, const QByteArray &data) noexcept {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->post(request, data);
-    connect(reply, &QNetworkReply::finished, this, &HttpClient::onReplyFinished);
+    post(url, data, [this](const Response &response) { emitResponse(response); });
 }
 
 void HttpClient::put(const QString &url, const QByteArray &data) noexcept {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->put(request, data);
-    connect(reply, &QNetworkReply::finished, this, &HttpClient::onReplyFinished);
+    put(url, data, [this](const Response &response) { emitResponse(response); });
 }
 
 void HttpClient::patch(const QString &url, const QByteArray &data) noexcept {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->sendCustomRequest(request, "PATCH", data);
-    connect(reply, &QNetworkReply::finished, this, &HttpClient::onReplyFinished);
+    patch(url, data, [this](const Response &response) { emitResponse(response); });
 }
 
 void HttpClient::del(const QString &url) noexcept {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
+    del(url, [this](const Response &response) { emitResponse(response); });
+}
+
+void HttpClient::get(const QString &url, ResponseCallback callback) noexcept {
+    dispatch("GET", createRequest(url), QByteArray(), std::move(callback));
+}
+
+void HttpClient::post(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept {
+    dispatch("POST", createRequest(url), data, std::move(callback));
+}
+
+void HttpClient::put(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept {
+    dispatch("PUT", createRequest(url), data, std::move(callback));
+}
+
+void HttpClient::patch(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept {
+    dispatch("PATCH", createRequest(url), data, std::move(callback));
+}
+
+void HttpClient::del(const QString &url, ResponseCallback callback) noexcept {
+    dispatch("DELETE", createRequest(url), QByteArray(), std::move(callback));
+}
+
+void HttpClient::request(const QByteArray &method, const QString &url, const QByteArray &data,
+                         const RequestOptions &options, ResponseCallback callback) noexcept {
+    startCall(makeCall(method, createRequest(url), data, std::move(callback), options));
+}
+
+QFuture<Response> HttpClient::get_future(const QString &url) noexcept {
+    return sendFuture("GET", url);
+}
+
+QFuture<Response> HttpClient::post_future(const QString &url, const QByteArray &data) noexcept {
+    return sendFuture("POST", url, data);
+}
+
+QFuture<Response> HttpClient::put_future(const QString &url, const QByteArray &data) noexcept {
+    return sendFuture("PUT", url, data);
+}
+
+QFuture<Response> HttpClient::patch_future(const QString &url, const QByteArray &data) noexcept {
+    return sendFuture("PATCH", url, data);
+}
+
+QFuture<Response> HttpClient::del_future(const QString &url) noexcept {
+    return sendFuture("DELETE", url);
+}
+
+QFuture<Response> HttpClient::sendFuture(const QByteArray &method, const QString &url, const QByteArray &data) {
+    auto promise = std::make_shared<QPromise<Response>>();
+    QFuture<Response> future = promise->future();
+    promise->start();
+    dispatch(method, createRequest(url), data, resolve(promise));
+    return future;
+}
+
+#ifdef HTTPCLIENT_COROUTINES
+ResponseAwaitable HttpClient::get_awaitable(const QString &url) {
+    return sendAwaitable("GET", url);
+}
+
+ResponseAwaitable HttpClient::post_awaitable(const QString &url, const QByteArray &data) {
+    return sendAwaitable("POST", url, data);
+}
+
+ResponseAwaitable HttpClient::put_awaitable(const QString &url, const QByteArray &data) {
+    return sendAwaitable("PUT", url, data);
+}
+
+ResponseAwaitable HttpClient::patch_awaitable(const QString &url, const QByteArray &data) {
+    return sendAwaitable("PATCH", url, data);
+}
+
+ResponseAwaitable HttpClient::del_awaitable(const QString &url) {
+    return sendAwaitable("DELETE", url);
+}
+
+ResponseAwaitable HttpClient::sendAwaitable(const QByteArray &method, const QString &url, const QByteArray &data) {
+    return ResponseAwaitable([this, method, url, data](ResponseCallback done) {
+        dispatch(method, createRequest(url), data, std::move(done));
+    });
+}
+#endif
+
+ResponseCallback HttpClient::resolve(std::shared_ptr<QPromise<Response>> promise) {
+    return [promise](const Response &response) {
+        promise->addResult(response);
+        promise->finish();
+    };
+}
+
+// State of one request that outlives its replies, so the request can be sent again.
+struct HttpClient::Call {
+    QByteArray method;
+    QNetworkRequest request;
+    QByteArray data;
+    ResponseCallback callback;
+    QNetworkAccessManager *manager = nullptr;  // manager of the thread the call runs on
+    bool refreshOn401 = true;                  // replay once with a refreshed token after a 401
+    std::shared_ptr<const RetryPolicy> retryPolicy;
+    std::shared_ptr<RetryBudget> retryBudget;
+    int attempts = 0;  // requests sent so far
+    int retries = 0;   // retries scheduled by retryPolicy
+    Timeouts timeouts;
+    QDeadlineTimer deadline{QDeadlineTimer::Forever};  // of all attempts together
+    std::shared_ptr<HedgeTracker> hedging;             // null unless a GET is hedged
+    QByteArray flightKey;                              // set if other requests may join this one
+    ResponseCache *cache = nullptr;
+    std::shared_ptr<const CacheEntry> cached;  // stale stored response of the request
+    QByteArray refreshKey;                     // set while refreshing a response served stale
+    QDateTime sentAt;                          // when the last attempt was sent
+
+    // True if response answers the call, also a 304 Not Modified validating the cached response.
+    bool succeeded(const Response &response) const { return response.ok() || (response.statusCode == 304 && cached); }
+};
+
+// Replies of one attempt. The first successful reply completes the attempt and aborts the others.
+struct HttpClient::Attempt {
+    QElapsedTimer clock;
+    QList<QNetworkReply *> replies;  // replies still running
+    bool done = false;               // the response has been handed to finishCall
+};
+
+void HttpClient::dispatch(const QByteArray &method, const QNetworkRequest &request, const QByteArray &data,
+                          ResponseCallback callback) {
+    startCall(makeCall(method, request, data, std::move(callback)));
+}
+
+std::shared_ptr<HttpClient::Call> HttpClient::makeCall(const QByteArray &method, const QNetworkRequest &request,
+                                                       const QByteArray &data, ResponseCallback callback,
+                                                       const RequestOptions &options) {
+    auto call = std::make_shared<Call>();
+    call->method = method;
+    call->request = request;
+    call->data = data;
+    call->callback = std::move(callback);
+    call->manager = threadManager();
+    call->retryPolicy = std::atomic_load(&retries);
+    call->retryBudget = std::atomic_load(&retryBudget);
+    call->timeouts = mergeTimeouts(options.timeouts, *std::atomic_load(&limits));
+    call->deadline = effectiveDeadline(options.deadline, call->timeouts.total);
+    if (method == "GET") {
+        call->hedging = std::atomic_load(&hedging);
+    }
+    call->cache = responseCache.load();
+    return call;
+}
+
+void HttpClient::startCall(const std::shared_ptr<Call> &call) {
+    if (call->attempts == 0 && call->method == "GET") {
+        if (call->cache && serveFromCache(call)) {
+            return;
+        }
+        if (coalesce.load() && joinFlight(call)) {
+            // The flight being joined refreshes the stored response just as well.
+            if (!call->refreshKey.isEmpty()) {
+                std::lock_guard<std::mutex> lock(flightsMutex);
+                refreshing.remove(call->refreshKey);
+            }
+            return;
+        }
+    }
+
+    // Nothing is sent once the deadline has passed, for example while waiting for a retry.
+    if (call->deadline.hasExpired()) {
+        Response response;
+        applyTimeout(response, "Deadline exceeded");
+        QMetaObject::invokeMethod(
+            call->manager, [this, call, response]() { finishCall(call, response); }, Qt::QueuedConnection);
+        return;
+    }
+
+    auto attempt = std::make_shared<Attempt>();
+    attempt->clock.start();
+    call->attempts++;
+    call->sentAt = QDateTime::currentDateTimeUtc();
+    sendAttempt(call, attempt, call->request);
+
+    HedgeTracker *tracker = call->hedging.get();
+    if (!tracker) {
+        return;
+    }
+    tracker->recordRequest();
+    std::chrono::milliseconds delay = tracker->delay();
+    if (delay.count() < 0) {
+        return;
+    }
+
+    // The timer dies with the first reply, which is gone once the attempt has completed.
+    QTimer::singleShot(delay, attempt->replies.first(), [this, call, attempt]() {
+        if (attempt->done || call->deadline.hasExpired() || !call->hedging->tryHedge()) {
+            return;
+        }
+
+        QNetworkRequest hedge = call->request;
+        const QString &host = call->hedging->policy().alternateHost;
+        if (!host.isEmpty()) {
+            QUrl url = hedge.url();
+            url.setHost(host);
+            hedge.setUrl(url);
+        }
+        sendAttempt(call, attempt, hedge);
+    });
+}
+
+void HttpClient::sendAttempt(const std::shared_ptr<Call> &call, const std::shared_ptr<Attempt> &attempt,
+                             const QNetworkRequest &request) {
+    QNetworkReply *reply = sendRequest(call->method, request, call->data);
+    bool hedged = !attempt->replies.isEmpty();
+    attempt->replies.append(reply);
+
+    // The reply is the context object so the callback runs in the thread the reply lives in
+    // and is dropped together with the reply if the client is destroyed first.
+    auto recorder = recordTiming(reply);
+    auto timeout = watchTimeouts(reply, call->timeouts, call->deadline);
+    connect(reply, &QNetworkReply::finished, reply, [this, reply, recorder, timeout, call, attempt, hedged]() {
+        Response response = readResponse(reply);
+        response.timing = recorder->finish();
+        response.hedged = hedged;
+        applyTimeout(response, *timeout);
+        reply->deleteLater();
+
+        attempt->replies.removeOne(reply);
+        if (attempt->done || (!call->succeeded(response) && !attempt->replies.isEmpty())) {
+            return;
+        }
+        attempt->done = true;
+
+        // Aborting emits finished, which removes the loser from the list.
+        for (QNetworkReply *other : QList<QNetworkReply *>(attempt->replies)) {
+            other->abort();
+        }
+        if (call->hedging && call->succeeded(response)) {
+            call->hedging->recordLatency(std::chrono::milliseconds(attempt->clock.elapsed()));
+        }
+        finishCall(call, response);
+    });
+}
+
+void HttpClient::finishCall(const std::shared_ptr<Call> &call, Response response) {
+    response.attempts = call->attempts;
+    response.retries = call->retries;
+    if (scheduleRetry(call, response)) {
+        return;
+    }
+
+    CredentialProvider *provider = credentials.load();
+    if (response.statusCode != 401 || !call->refreshOn401 || !provider || !provider->canRefresh()) {
+        completeCall(call, response);
+        return;
+    }
+    call->refreshOn401 = false;
+
+    // Replays the call with the provider's current token on the thread it runs on. The refresh
+    // completes on the provider's thread, possibly after the client or the network thread
+    // that ran the call is gone, in which case the replay is dropped.
+    QPointer<HttpClient> client(this);
+    auto replay = [client, call, provider, response](bool refreshed) {
+        if (!client) {
+            return;
+        }
+        std::shared_ptr<const QByteArray> authorization = provider->authorization();
+        if (!refreshed || !authorization) {
+            client->completeCall(call, response);
+            return;
+        }
+        call->request.setRawHeader("Authorization", *authorization);
+        client->startCall(call);
+    };
+
+    // Another request may already have refreshed the token since this one was sent.
+    std::shared_ptr<const QByteArray> current = provider->authorization();
+    if (current && *current != call->request.rawHeader("Authorization")) {
+        replay(true);
+        return;
+    }
+
+    // Concurrent 401s are coalesced by the provider into a single refresh.
+    QPointer<QNetworkAccessManager> manager(call->manager);
+    provider->refresh([manager, replay](bool refreshed) {
+        if (manager) {
+            QMetaObject::invokeMethod(manager.data(), [replay, refreshed]() { replay(refreshed); }, Qt::QueuedConnection);
+        }
+    });
+}
+
+bool HttpClient::serveFromCache(const std::shared_ptr<Call> &call) {
+    std::shared_ptr<const CacheEntry> entry = call->cache->lookup(call->request);
+    if (!entry) {
+        return false;
+    }
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    bool fresh = entry->isFresh(now);
+    if (!fresh) {
+        // Kept to be freshened by a 304 or to stand in for an error of the origin.
+        call->cached = entry;
+        ResponseCache::addValidators(&call->request, *entry);
+        if (!entry->isUsableWhileRevalidating(now)) {
+            return false;
+        }
+    }
+
+    Response response = entry->response;
+    response.fromCache = true;
+    response.stale = !fresh;
+    response.attempts = 0;
+    response.retries = 0;
+    response.hedged = false;
+    response.coalesced = false;
+
+    // Keep the asyncronous contract and deliver from the event loop.
+    QMetaObject::invokeMethod(
+        call->manager,
+        [callback = call->callback, response]() {
+            if (callback) {
+                callback(response);
+            }
+        },
+        Qt::QueuedConnection);
+    if (fresh) {
+        return true;
+    }
+
+    // Served stale within stale-while-revalidate: the call goes on in the background, without
+    // callback, to refresh the stored response unless a refresh of the URL is already running.
+    QByteArray key = call->request.url().toEncoded();
+    {
+        std::lock_guard<std::mutex> lock(flightsMutex);
+        if (refreshing.contains(key)) {
+            return true;
+        }
+        refreshing.insert(key);
+    }
+    call->callback = nullptr;
+    call->refreshKey = key;
+    return false;
+}
+
+Response HttpClient::updateCache(const std::shared_ptr<Call> &call, const Response &response) {
+    if (call->method == "GET") {
+        // The stored body is still valid, only its headers are refreshed.
+        if (response.statusCode == 304 && call->cached) {
+            Response freshened = call->cache->freshen(call->request, *call->cached, response, call->sentAt);
+            freshened.fromCache = true;
+            freshened.revalidated = true;
+            return freshened;
+        }
+
+        // The origin is failing, a stored response within its stale-if-error window stands in.
+        if (call->cached && isOriginError(response) && call->cached->isUsableOnError(QDateTime::currentDateTimeUtc())) {
+            Response stale = call->cached->response;
+            stale.timing = response.timing;
+            stale.attempts = response.attempts;
+            stale.retries = response.retries;
+            stale.hedged = response.hedged;
+            stale.fromCache = true;
+            stale.stale = true;
+            return stale;
+        }
+        if (response.error == QNetworkReply::NoError || response.statusCode != 0) {
+            call->cache->store(call->request, response, call->sentAt);
+        }
+    } else if (call->method != "HEAD" && response.statusCode >= 200 && response.statusCode < 400) {
+        // A successful unsafe request may have changed the resource (RFC 9111 4.4).
+        call->cache->invalidate(call->request.url());
+    }
+    return response;
+}
+
+void HttpClient::completeCall(const std::shared_ptr<Call> &call, const Response &result) {
+    Response response = call->cache ? updateCache(call, result) : result;
+
+    QList<ResponseCallback> followers;
+    if (!call->flightKey.isEmpty() || !call->refreshKey.isEmpty()) {
+        std::lock_guard<std::mutex> lock(flightsMutex);
+        followers = flights.take(call->flightKey);
+        refreshing.remove(call->refreshKey);
+    }
+
+    if (call->callback) {
+        call->callback(response);
+    }
+    for (const ResponseCallback &follower : followers) {
+        follower(response);
+    }
+}
+
+bool HttpClient::joinFlight(const std::shared_ptr<Call> &call) {
+    // Replies of different threads can not be shared, so the manager is part of the key.
+    QByteArray key = QByteArray::number(quintptr(call->manager)) + ' ' + call->method + ' ' +
+                     call->request.url().toEncoded() + '\n';
+    for (const QByteArray &name : call->request.rawHeaderList()) {
+        key += name + ": " + call->request.rawHeader(name) + '\n';
+    }
+
+    std::lock_guard<std::mutex> lock(flightsMutex);
+    auto flight = flights.find(key);
+    if (flight == flights.end()) {
+        flights.insert(key, QList<ResponseCallback>());
+        call->flightKey = key;
+        return false;
+    }
+
+    flight->append([callback = call->callback](const Response &response) {
+        Response shared = response;
+        shared.coalesced = true;
+        if (callback) {
+            callback(shared);
+        }
+    });
+    return true;
+}
 
-    QNetworkReply *reply = manager->deleteResource(request);
-    connect(reply, &QNetworkReply::finished, this, &HttpClient::onReplyFinished);
+bool HttpClient::scheduleRetry(const std::shared_ptr<Call> &call, const Response &response) {
+    const RetryPolicy *policy = call->retryPolicy.get();
+    if (!policy) {
+        return false;
+    }
+
+    if (!policy->isTransient(response)) {
+        if (call->succeeded(response)) {
+            call->retryBudget->recordSuccess();
+        }
+        return false;
+    }
+
+    // Every transient failure is charged, also those of requests that are not retried.
+    if (!call->retryBudget->recordFailure() || call->retries + 1 >= policy->maxAttempts ||
+        !policy->canRetry(call->method, call->request, response)) {
+        return false;
+    }
+
+    // A retry that could not start before the deadline is not worth waiting for.
+    std::chrono::milliseconds delay = policy->backoff(call->retries + 1, response);
+    if (delay.count() < 0 || (!call->deadline.isForever() && delay.count() >= call->deadline.remainingTime())) {
+        return false;
+    }
+
+    call->retries++;
+    QTimer::singleShot(delay, call->manager, [this, call]() { startCall(call); });
+    return true;
+}
+
+void HttpClient::stream(const QString &url, ChunkCallback onChunk, ResponseCallback onFinished) noexcept {
+    dispatchStream(sendRequest("GET", url), std::move(onChunk), std::move(onFinished));
+}
+
+void HttpClient::stream(const QString &url, QIODevice *sink, ResponseCallback onFinished) noexcept {
+    auto onChunk = [sink](const QByteArray &chunk) { return sink->write(chunk) == chunk.size(); };
+    dispatchStream(sendRequest("GET", url), onChunk, std::move(onFinished));
 }
 
-void HttpClient::onReplyFinished() {
-    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-    bool requestFailed = reply->error() != QNetworkReply::NoError;
+void HttpClient::stream_sync(const QString &url, ChunkCallback onChunk) {
+    QNetworkRequest request = createRequest(url);
+    Response response = execute([this, request, onChunk](ResponseCallback done) {
+        dispatchStream(sendRequest("GET", request), onChunk, std::move(done));
+    });
 
-    QByteArray responseData = reply->readAll();
-    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (!response.ok()) {
+        throw NetworkException(response);
+    }
+}
+
+void HttpClient::download(const QString &url, const QString &path, ResponseCallback onFinished,
+                          const DownloadOptions &options) noexcept {
+    if (options.resume) {
+        resumableDownload(url, path, std::move(onFinished));
+        return;
+    }
+
+    auto file = std::make_shared<QSaveFile>(path);
+    if (!file->open(QIODevice::WriteOnly)) {
+        Response response;
+        response.error = QNetworkReply::UnknownContentError;
+        response.errorString = file->errorString();
 
-    reply->deleteLater();
-    if (requestFailed || statusCode > 300) {
-        emit error(responseData);
+        // Keep the asyncronous contract and report the failure from the event loop.
+        QMetaObject::invokeMethod(
+            threadManager(),
+            [response, onFinished = std::move(onFinished)]() {
+                if (onFinished) {
+                    onFinished(response);
+                }
+            },
+            Qt::QueuedConnection);
         return;
     }
-    emit success(responseData);
+
+    QNetworkReply *reply = sendRequest("GET", url);
+    if (options.preallocate) {
+        connect(reply, &QNetworkReply::metaDataChanged, reply, [reply, file]() {
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+            if (statusCode <= 300 && length > 0 && file->pos() == 0) {
+                preallocate(file.get(), length);
+            }
+        });
+    }
+
+    auto onChunk = [file](const QByteArray &chunk) { return file->write(chunk) == chunk.size(); };
+    dispatchStream(reply, onChunk, [file, onFinished = std::move(onFinished)](const Response &result) {
+        Response response = result;
+
+        if (response.ok()) {
+            // Drop the unused tail if the server sent less than it announced.
+            if (file->size() > file->pos()) {
+                file->resize(file->pos());
+            }
+            if (!file->commit()) {
+                response.error = QNetworkReply::UnknownContentError;
+                response.errorString = file->errorString();
+            }
+        } else {
+            if (file->error() != QFileDevice::NoError) {
+                response.errorString = file->errorString();
+            }
+            file->cancelWriting();
+        }
+
+        if (onFinished) {
+            onFinished(response);
+        }
+    });
+}
+
+void HttpClient::resumableDownload(const QString &url, const QString &path, ResponseCallback onFinished) {
+    auto download = std::make_shared<ResumableDownload>();
+    download->path = path;
+    download->file.setFileName(partialPath(path));
+    download->journal = readJournal(path);
+
+    if (!download->file.open(QIODevice::ReadWrite)) {
+        Response response;
+        response.error = QNetworkReply::UnknownContentError;
+        response.errorString = download->file.errorString();
+        QMetaObject::invokeMethod(
+            threadManager(),
+            [response, onFinished = std::move(onFinished)]() {
+                if (onFinished) {
+                    onFinished(response);
+                }
+            },
+            Qt::QueuedConnection);
+        return;
+    }
+
+    // Only resume a partial body of the same url that can be validated with If-Range,
+    // which accepts strong validators only. Bytes beyond the journal may be torn.
+    DownloadJournal &journal = download->journal;
+    QByteArray validator = journal.etag.startsWith("W/") ? QByteArray() : journal.etag;
+    if (validator.isEmpty()) {
+        validator = journal.lastModified;
+    }
+    if (journal.url != url || validator.isEmpty()) {
+        journal = DownloadJournal();
+        journal.url = url;
+    }
+    journal.bytes = qMin(journal.bytes, download->file.size());
+
+    QNetworkRequest request = createRequest(url);
+    if (journal.bytes > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(journal.bytes) + "-");
+        request.setRawHeader("If-Range", validator);
+    }
+    QNetworkReply *reply = sendRequest("GET", request);
+
+    // Position the partial file once we know whether the server resumed or restarted.
+    connect(reply, &QNetworkReply::metaDataChanged, reply, [reply, download]() {
+        DownloadJournal &journal = download->journal;
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        if (statusCode == 206) {
+            // Content-Range: bytes <first>-<last>/<length>
+            QByteArray range = reply->rawHeader("Content-Range");
+            qint64 first = range.mid(6, range.indexOf('-') - 6).trimmed().toLongLong();
+            if (!range.startsWith("bytes ") || first != journal.bytes) {
+                download->error = "Server resumed the download at an unexpected offset";
+                journal.bytes = 0;
+                writeJournal(download.get());
+                reply->abort();
+                return;
+            }
+        } else if (statusCode == 200) {
+            journal.bytes = 0;
+            journal.etag = reply->rawHeader("ETag");
+            journal.lastModified = reply->rawHeader("Last-Modified");
+        } else {
+            return;
+        }
+
+        download->file.resize(journal.bytes);
+        download->file.seek(journal.bytes);
+        writeJournal(download.get());
+    });
+
+    auto onChunk = [download](const QByteArray &chunk) {
+        if (download->file.write(chunk) != chunk.size()) {
+            download->error = download->file.errorString();
+            return false;
+        }
+
+        download->journal.bytes += chunk.size();
+        if (download->journal.bytes - download->journaledBytes >= journalInterval) {
+            writeJournal(download.get());
+        }
+        return true;
+    };
+
+    dispatchStream(reply, onChunk, [download, onFinished = std::move(onFinished)](const Response &result) {
+        Response response = result;
+        if (!download->error.isEmpty()) {
+            response.errorString = download->error;
+        }
+
+        if (response.ok()) {
+            download->file.close();
+            QFile::remove(download->path);
+            if (download->file.rename(download->path)) {
+                QFile::remove(journalPath(download->path));
+            } else {
+                response.error = QNetworkReply::UnknownContentError;
+                response.errorString = download->file.errorString();
+            }
+        } else if (response.statusCode == 416) {
+            // The partial file no longer matches anything the server can resume.
+            download->file.remove();
+            QFile::remove(journalPath(download->path));
+        } else {
+            writeJournal(download.get());
+            download->file.close();
+        }
+
+        if (onFinished) {
+            onFinished(response);
+        }
+    });
+}
+
+void HttpClient::download_sync(const QString &url, const QString &path, const DownloadOptions &options) {
+    Response response = execute([this, url, path, options](ResponseCallback done) {
+        download(url, path, std::move(done), options);
+    });
+
+    if (!response.ok()) {
+        throw NetworkException(response);
+    }
+}
+
+void HttpClient::setStreamBufferSize(qint64 bytes) {
+    bufferSize = bytes;
+}
+
+qint64 HttpClient::streamBufferSize() const {
+    return bufferSize;
+}
+
+void HttpClient::dispatchStream(QNetworkReply *reply, ChunkCallback onChunk, ResponseCallback onFinished) {
+    const qint64 chunkSize = bufferSize;
+    auto aborted = std::make_shared<bool>(false);
+
+    // Bound the memory held by Qt for this reply. Once the buffer is full Qt stops
+    // reading from the socket until we consume some data.
+    reply->setReadBufferSize(chunkSize);
+
+    // Drains the buffered body into onChunk. Returns false if the consumer aborted.
+    // An error body is not streamed but must still be read, or a full buffer stalls the reply.
+    auto errorBody = std::make_shared<QByteArray>();
+    auto drain = [reply, onChunk, chunkSize, aborted, errorBody]() {
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (*aborted) {
+            return;
+        }
+        if (statusCode > 300) {
+            drainErrorBody(reply, chunkSize, errorBody.get());
+            return;
+        }
+
+        while (reply->bytesAvailable() > 0) {
+            if (!onChunk(reply->read(chunkSize))) {
+                *aborted = true;
+                reply->abort();
+                return;
+            }
+        }
+    };
+
+    auto recorder = recordTiming(reply);
+    auto timeout = watchClientTimeouts(reply);
+    connect(reply, &QNetworkReply::readyRead, reply, drain);
+    connect(reply, &QNetworkReply::finished, reply,
+            [reply, drain, aborted, errorBody, recorder, timeout, onFinished = std::move(onFinished)]() {
+        drain();
+        Response response = readResponse(reply);
+        if (response.statusCode > 300) {
+            response.body = *errorBody;
+        }
+        response.timing = recorder->finish();
+        applyTimeout(response, *timeout);
+        reply->deleteLater();
+
+        if (*aborted) {
+            response.body.clear();
+            response.error = QNetworkReply::OperationCanceledError;
+            response.errorString = "Transfer aborted by the chunk consumer";
+        }
+        if (onFinished) {
+            onFinished(response);
+        }
+    });
+}
+
+void HttpClient::emitResponse(const Response &response) {
+    emit responseReceived(response);
+    if (!response.ok()) {
+        emit error(ownedBody(response));
+        return;
+    }
+    emit success(ownedBody(response));
 }
 
 QByteArray HttpClient::get_sync(const QString &url) {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->get(request);
-    return waitForResponse(reply);
+    return ownedBody(waitForResponse("GET", url));
 }
 
 QByteArray HttpClient::post_sync(const QString &url, const QByteArray &data) {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->post(request, data);
-    return waitForResponse(reply);
+    return ownedBody(waitForResponse("POST", url, data));
 }
 
 QByteArray HttpClient::put_sync(const QString &url, const QByteArray &data) {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->put(request, data);
-    return waitForResponse(reply);
+    return ownedBody(waitForResponse("PUT", url, data));
 }
 
 QByteArray HttpClient::patch_sync(const QString &url, const QByteArray &data) {
-    QUrl qUrl(url);
-    QNetworkRequest request(qUrl);
-    setHeaders(&request);
-    QNetworkReply *reply = manager->sendCustomRequest(request, "PATCH", data);
-    return waitForResponse(reply);
+    return ownedBody(waitForResponse("PATCH", url, data));
 }
 
 QByteArray HttpClient::del_sync(const QString &url) {
+    return ownedBody(waitForResponse("DELETE", url));
+}
+
+Response HttpClient::request_sync(const QByteArray &method, const QString &url, const QByteArray &data) {
+    return waitForResponse(method, url, data);
+}
+
+Response HttpClient::request_sync(const QByteArray &method, const QString &url, const QByteArray &data,
+                                  const RequestOptions &options) {
+    return waitForResponse(method, url, data, options);
+}
+
+QNetworkRequest HttpClient::createRequest(const QString &url) {
     QUrl qUrl(url);
     QNetworkRequest request(qUrl);
     setHeaders(&request);
+    return request;
+}
+
+QNetworkReply *HttpClient::sendRequest(const QByteArray &method, const QString &url, const QByteArray &data) {
+    return sendRequest(method, createRequest(url), data);
+}
+
+QNetworkReply *HttpClient::sendRequest(const QByteArray &method, const QNetworkRequest &request,
+                                       const QByteArray &data) {
+    TlsSessionCache *sessions = sessionCache.load();
+    if (!sessions || request.url().scheme() != "https") {
+        return send(threadManager(), method, request, data);
+    }
+
+    // Offer the stored session of the host in case the request opens a new connection, and
+    // let Qt hand out the session of the connection.
+    QString host = request.url().host() + ":" + QString::number(request.url().port(443));
+    QByteArray ticket = sessions->ticket(host);
+    QSslConfiguration ssl = request.sslConfiguration();
+    ssl.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    if (!ticket.isEmpty()) {
+        ssl.setSessionTicket(ticket);
+    }
+    QNetworkRequest resuming = request;
+    resuming.setSslConfiguration(ssl);
 
-    QNetworkReply *reply = manager->deleteResource(request);
-    return waitForResponse(reply);
+    QNetworkReply *reply = send(threadManager(), method, resuming, data);
+    watchHandshake(reply, sessions, host, !ticket.isEmpty());
+    return reply;
 }
 
 void HttpClient::setHeaders(QNetworkRequest *request) {
     // Set all request headers onto the request
-    QMapIterator<QString, QString> it(headers);
-    while (it.hasNext()) {
-        it.next();
-        request->setRawHeader(it.key().toLocal8Bit(), it.value().toLocal8Bit());
+    std::shared_ptr<const HeaderBlock> block = std::atomic_load(&encodedHeaders);
+    for (const QPair<QByteArray, QByteArray> &header : *block) {
+        request->setRawHeader(header.first, header.second);
     }
 
     // Add authorization header if token is set
-    if (!token.isEmpty()) {
-        request->setRawHeader("Authorization", QString("Bearer ").append(token).toLocal8Bit());
+    CredentialProvider *provider = credentials.load();
+    std::shared_ptr<const QByteArray> authorization =
+        provider ? provider->authorization() : std::atomic_load(&tokenHeader);
+    if (authorization) {
+        request->setRawHeader("Authorization", *authorization);
+    }
+
+    std::shared_ptr<const Protocol> settings = std::atomic_load(&protocol);
+    HttpVersion version = settings->options.version;
+    request->setAttribute(QNetworkRequest::Http2AllowedAttribute, version != HttpVersion::Http1Only);
+    request->setAttribute(QNetworkRequest::Http2DirectAttribute, version == HttpVersion::Http2PriorKnowledge);
+    request->setHttp2Configuration(settings->http2);
+
+    std::shared_ptr<const Tls> profile = std::atomic_load(&tls);
+    if (profile && request->url().scheme() == "https") {
+        request->setSslConfiguration(profile->configuration);
+    }
+}
+
+QNetworkAccessManager *HttpClient::threadManager() const {
+    NetworkThread *network = syncThread.load();
+    if (network && network->isCurrentThread()) {
+        return network->manager();
     }
+    return manager;
 }
 
-QByteArray HttpClient::waitForResponse(QNetworkReply *reply) {
-    QEventLoop loop;
-    connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
+Response HttpClient::execute(std::function<void(ResponseCallback done)> start) {
+    std::call_once(syncThreadStarted, [this]() { syncThread.store(new NetworkThread()); });
+    NetworkThread *network = syncThread.load();
 
-    bool requestFailed = reply->error() != QNetworkReply::NoError;
-    QByteArray responseData = reply->readAll();
-    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // Blocking on the network thread itself would deadlock, so a syncronous call made from
+    // a callback running there falls back to waiting in a local event loop.
+    if (network->isCurrentThread()) {
+        Response response;
+        QEventLoop loop;
+        start([&](const Response &result) {
+            response = result;
+            loop.quit();
+        });
+        loop.exec();
+        return response;
+    }
 
-    // Free reply memory
-    reply->deleteLater();
+    auto promise = std::make_shared<std::promise<Response>>();
+    std::future<Response> future = promise->get_future();
+    network->post([start = std::move(start), promise]() {
+        start([promise](const Response &response) { promise->set_value(response); });
+    });
+    return future.get();
+}
 
-    if (requestFailed || statusCode > 300) {
-        throw NetworkException(statusCode, responseData);
+Response HttpClient::waitForResponse(const QByteArray &method, const QString &url, const QByteArray &data,
+                                     const RequestOptions &options) {
+    // Build the request on the calling thread, the network thread only sends it.
+    QNetworkRequest request = createRequest(url);
+
+    // A token refresh needs the provider's thread, which is blocked here if it is ours.
+    CredentialProvider *provider = credentials.load();
+    bool refreshOn401 = !provider || provider->thread() != QThread::currentThread();
+
+    Response response = execute([this, method, request, data, options, refreshOn401](ResponseCallback done) {
+        std::shared_ptr<Call> call = makeCall(method, request, data, std::move(done), options);
+        call->refreshOn401 = refreshOn401;
+        startCall(call);
+    });
+
+    if (!response.ok()) {
+        throw NetworkException(response);
+    }
+    return response;
+}
+
+std::shared_ptr<QString> HttpClient::watchClientTimeouts(QNetworkReply *reply) const {
+    Timeouts timeouts = *std::atomic_load(&limits);
+    return watchTimeouts(reply, timeouts, effectiveDeadline(QDeadlineTimer(QDeadlineTimer::Forever), timeouts.total));
+}
+
+Response HttpClient::readResponse(QNetworkReply *reply) {
+    Response response;
+    response.statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    response.reasonPhrase = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray();
+    response.rawHeaders = reply->rawHeaderPairs();
+    response.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    response.error = reply->error();
+    if (response.error != QNetworkReply::NoError) {
+        response.errorString = reply->errorString();
     }
-    return responseData;
+    response.body = reply->readAll();
+    return response;
+}
+
+bool Response::ok() const {
+    return error == QNetworkReply::NoError && statusCode <= 300;
+}
+
+QByteArray Response::header(const QByteArray &name) const {
+    for (const QNetworkReply::RawHeaderPair &pair : rawHeaders) {
+        if (pair.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return pair.second;
+        }
+    }
+    return QByteArray();
+}
+
+bool Response::hasHeader(const QByteArray &name) const {
+    for (const QNetworkReply::RawHeaderPair &pair : rawHeaders) {
+        if (pair.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Response::timedOut() const {
+    return error == QNetworkReply::TimeoutError;
 }
 
 void writeFile(const QString &path, const QByteArray &data) {
-    QFile *file = new QFile(path);
-    if (file->open(QIODevice::WriteOnly)) {
-        file->write(data);
-        file->close();
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        file.close();
     }
 }
 
@@ -177,12 +1468,26 @@ QImage imageFromBytes(const QByteArray &data) {
     return img;
 }
 
-NetworkException::NetworkException(int statusCode, const QString &message) : statusCode(statusCode), message(message.toStdString()) {}
+NetworkException::NetworkException(int statusCode, const QString &message) : statusCode(statusCode), message(message.toUtf8()) {
+    response.statusCode = statusCode;
+    response.body = this->message;
+}
+
+NetworkException::NetworkException(const Response &response)
+    : statusCode(response.statusCode),
+      response(response),
+      message(response.body.isEmpty() ? response.errorString.toUtf8() : ownedBody(response)) {}
+
 int NetworkException::getStatusCode() const {
     return statusCode;
 }
 
-// Returns the exception a c-style character array.
+const Response &NetworkException::getResponse() const {
+    return response;
+}
+
+// Returns the exception a c-style character array. The message owns its bytes, a body
+// mapped by the DiskCache is copied into it, so its data is null-terminated.
 const char *NetworkException::what() const noexcept {
-    return message.c_str();
+    return message.constData();
 };
@@ -0,0 +1,130 @@
+#include "httpclient/httpclientpool.h"
+
+#include "httpclient/networkthread.h"
+
+HttpClientPool::HttpClientPool(int threadCount, QObject *parent)
+    : HttpClientPool(threadCount, QMap<QString, QString>(), parent) {}
+
+HttpClientPool::HttpClientPool(int threadCount, const QMap<QString, QString> &headers, QObject *parent)
+    : QObject(parent) {
+    workers.resize(qMax(threadCount, 1));
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker &worker = workers[i];
+        worker.thread = std::make_unique<NetworkThread>(QString("httpclient-pool-%1").arg(qint64(i)));
+
+        // Each client must be created on the thread that drives its replies.
+        QObject *context = worker.thread->context();
+        QMetaObject::invokeMethod(
+            context, [&worker, context, headers]() { worker.client = new HttpClient(context, headers); },
+            Qt::BlockingQueuedConnection);
+    }
+}
+
+HttpClientPool::~HttpClientPool() {
+    // Each NetworkThread destroys its client on its own thread when it stops.
+    workers.clear();
+}
+
+int HttpClientPool::threadCount() const {
+    return int(workers.size());
+}
+
+void HttpClientPool::setCredentialProvider(CredentialProvider *provider) {
+    for (Worker &worker : workers) {
+        worker.client->setCredentialProvider(provider);
+    }
+}
+
+void HttpClientPool::setRetryPolicy(const RetryPolicy &policy) {
+    for (Worker &worker : workers) {
+        worker.client->setRetryPolicy(policy);
+    }
+}
+
+void HttpClientPool::setHedgePolicy(const HedgePolicy &policy) {
+    for (Worker &worker : workers) {
+        worker.client->setHedgePolicy(policy);
+    }
+}
+
+void HttpClientPool::setCache(ResponseCache *cache) {
+    for (Worker &worker : workers) {
+        worker.client->setCache(cache);
+    }
+}
+
+bool HttpClientPool::setTlsProfile(const TlsProfile &profile) {
+    // Parsed once, the configuration is shared by all clients.
+    std::shared_ptr<const HttpClient::Tls> settings = HttpClient::loadTls(profile);
+    if (!settings) {
+        return false;
+    }
+    for (Worker &worker : workers) {
+        std::atomic_store(&worker.client->tls, settings);
+    }
+    return true;
+}
+
+void HttpClientPool::setTlsSessionCache(TlsSessionCache *sessions) {
+    for (Worker &worker : workers) {
+        worker.client->setTlsSessionCache(sessions);
+    }
+}
+
+void HttpClientPool::setCoalescing(bool enabled) {
+    for (Worker &worker : workers) {
+        worker.client->setCoalescing(enabled);
+    }
+}
+
+void HttpClientPool::setTimeouts(const Timeouts &timeouts) {
+    for (Worker &worker : workers) {
+        worker.client->setTimeouts(timeouts);
+    }
+}
+
+void HttpClientPool::setProtocolOptions(const ProtocolOptions &options) {
+    for (Worker &worker : workers) {
+        worker.client->setProtocolOptions(options);
+    }
+}
+
+void HttpClientPool::prewarm(const QStringList &origins, int connections) {
+    for (Worker &worker : workers) {
+        worker.client->prewarm(origins, connections);
+    }
+}
+
+QFuture<Response> HttpClientPool::get(const QString &url) {
+    return send("GET", url);
+}
+
+QFuture<Response> HttpClientPool::post(const QString &url, const QByteArray &data) {
+    return send("POST", url, data);
+}
+
+QFuture<Response> HttpClientPool::put(const QString &url, const QByteArray &data) {
+    return send("PUT", url, data);
+}
+
+QFuture<Response> HttpClientPool::patch(const QString &url, const QByteArray &data) {
+    return send("PATCH", url, data);
+}
+
+QFuture<Response> HttpClientPool::del(const QString &url) {
+    return send("DELETE", url);
+}
+
+QFuture<Response> HttpClientPool::send(const QByteArray &method, const QString &url, const QByteArray &data) {
+    auto promise = std::make_shared<QPromise<Response>>();
+    QFuture<Response> future = promise->future();
+    promise->start();
+
+    Worker &worker = workers[nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+    HttpClient *client = worker.client;
+    worker.thread->post([client, method, url, data, promise]() {
+        client->dispatch(method, client->createRequest(url), data, HttpClient::resolve(promise));
+    });
+    return future;
+}
@@ -0,0 +1,167 @@
+#ifndef __CREDENTIALPROVIDER_H__
+#define __CREDENTIALPROVIDER_H__
+
+/**
+ * @file credentialprovider.h
+ * @brief Per-client bearer credentials with lock-free token swaps and proactive refresh.
+ */
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief CredentialProvider holds the bearer token of one or more HttpClient instances.
+ *
+ * The token is stored in an immutable block that is swapped atomically, so requests built on
+ * any thread read it without locking while another thread replaces it. Different clients can
+ * use different providers, which allows several credentials in one process.
+ *
+ * If a refresh function is set, the provider refreshes the token in the background shortly
+ * before the exp claim of the current JWT, so requests never wait for a re-login.
+ */
+class CredentialProvider : public QObject {
+    Q_OBJECT
+
+   public:
+    /**
+     * @brief Function obtaining a new token, for example by logging in again. It must call
+     * done exactly once, from any thread, with the new token or an empty string on failure.
+     */
+    using RefreshFunction = std::function<void(std::function<void(const QString &token)> done)>;
+
+    /**
+     * @brief Construct a new CredentialProvider without a token.
+     *
+     * @param parent QObject*
+     */
+    explicit CredentialProvider(QObject *parent = nullptr);
+
+    /**
+     * @brief Construct a new CredentialProvider with an initial token.
+     *
+     * @param token QString
+     * @param parent QObject*
+     */
+    CredentialProvider(const QString &token, QObject *parent = nullptr);
+
+    /**
+     * @brief Replace the token. Safe to call from any thread; requests already being built
+     * keep the token they have read.
+     *
+     * @param token QString
+     */
+    void setToken(const QString &token);
+
+    /**
+     * @brief Get the current token.
+     *
+     * @return QString
+     */
+    QString token() const;
+
+    /**
+     * @brief Get the encoded Authorization header value ("Bearer <token>"), or null if there
+     * is no token. Lock-free and safe to call from any thread.
+     *
+     * @return std::shared_ptr<const QByteArray>
+     */
+    std::shared_ptr<const QByteArray> authorization() const;
+
+    /**
+     * @brief Get the expiry of the current token taken from its exp claim. Invalid if the
+     * token is not a JWT or has no exp claim.
+     *
+     * @return QDateTime
+     */
+    QDateTime expiresAt() const;
+
+    /**
+     * @brief Set the function used to obtain a new token.
+     *
+     * @param refresh RefreshFunction
+     */
+    void setRefreshFunction(RefreshFunction refresh);
+
+    /**
+     * @brief Set how long before expiry the token is refreshed. Defaults to 60 seconds.
+     * Tokens living shorter than the margin are refreshed halfway through their lifetime,
+     * and scheduled refreshes are at least 10 seconds apart.
+     *
+     * @param margin std::chrono::seconds
+     */
+    void setRefreshMargin(std::chrono::seconds margin);
+
+    /**
+     * @brief Returns true if a refresh function is set.
+     *
+     * @return bool
+     */
+    bool canRefresh() const;
+
+    /**
+     * @brief Refresh the token now. Concurrent calls are coalesced into a single call of the
+     * refresh function; every caller's onRefreshed is invoked on the provider's thread once it
+     * completes, with true if a new token was obtained. Safe to call from any thread.
+     *
+     * @param onRefreshed std::function<void(bool refreshed)>
+     */
+    void refresh(std::function<void(bool refreshed)> onRefreshed = nullptr);
+
+    /**
+     * @brief Read the exp claim of a JWT without verifying it.
+     *
+     * @param token QString
+     * @return QDateTime invalid if token is not a JWT with an exp claim.
+     */
+    static QDateTime jwtExpiry(const QString &token);
+
+   signals:
+    /**
+     * @brief Signal which is emitted when the token has been replaced.
+     *
+     * @param token
+     */
+    void tokenChanged(const QString &token);
+
+    /**
+     * @brief Signal which is emitted when the refresh function reported a failure.
+     *
+     */
+    void refreshFailed();
+
+   private:
+    // Immutable snapshot of the credentials, swapped as a whole.
+    struct Credentials {
+        QString token;
+        std::shared_ptr<const QByteArray> authorization;
+        QDateTime expiresAt;
+    };
+
+    std::shared_ptr<const Credentials> credentials;
+    mutable std::mutex mutex;  // guards refreshFunction, which is set and read from any thread
+    RefreshFunction refreshFunction;
+    std::chrono::seconds refreshMargin{60};
+    QTimer refreshTimer;
+    QElapsedTimer lastRefresh;  // since the last refresh started by refreshTimer
+    bool refreshing = false;
+    QList<std::function<void(bool refreshed)>> waiters;  // callers of the running refresh
+
+    // Copies refreshFunction under mutex.
+    RefreshFunction refresher() const;
+
+    // Arms refreshTimer for the expiry of the current token. Runs on the provider's thread.
+    void scheduleRefresh();
+
+    // Called with the result of the refresh function on the provider's thread.
+    void onRefreshed(const QString &token);
+};
+
+#endif /* __CREDENTIALPROVIDER_H__ */
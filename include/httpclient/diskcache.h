@@ -0,0 +1,137 @@
+#ifndef __DISKCACHE_H__
+#define __DISKCACHE_H__
+
+/**
+ * @file diskcache.h
+ * @brief Persistent, content-addressed tier of the ResponseCache.
+ */
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <memory>
+#include <mutex>
+
+#include "httpclient/responsecache.h"
+
+/**
+ * @brief DiskCache keeps cached responses in a directory so they survive restarts.
+ *
+ * Bodies are stored once per content, in files named by the SHA-256 of the body, and are read
+ * back through a memory mapping: the body of a loaded entry is a QByteArray over the mapped file
+ * rather than a copy. The response holds its mapping in Response::bodyStorage, so a mapping stays
+ * valid as long as a copy of the response exists, even after the DiskCache is destroyed, and is
+ * released with the last one. A copy of the body alone does not keep the mapping.
+ *
+ * The index of entries is a JSON file replaced atomically with QSaveFile after each change and
+ * body files are complete before the index refers to them, so a crash never leaves the index
+ * pointing at a partial body. Bodies no longer referenced by the index are removed when the
+ * cache is opened. The least recently used entries are evicted once the bodies exceed maxBytes.
+ *
+ * Install it behind a ResponseCache with ResponseCache::setDiskCache. All methods are thread-safe.
+ */
+class DiskCache {
+   public:
+    /**
+     * @brief Open or create the cache in directory.
+     *
+     * @param directory QString
+     * @param maxBytes qint64
+     */
+    explicit DiskCache(const QString &directory, qint64 maxBytes = 256 * 1024 * 1024);
+
+    /**
+     * @brief Set the byte budget of the stored bodies and evict entries exceeding it.
+     *
+     * @param bytes qint64
+     */
+    void setMaxBytes(qint64 bytes);
+
+    /**
+     * @brief Get the byte budget of the stored bodies.
+     *
+     * @return qint64
+     */
+    qint64 maxBytes() const;
+
+    /**
+     * @brief Get the number of body bytes stored on disk.
+     *
+     * @return qint64
+     */
+    qint64 size() const;
+
+    /**
+     * @brief Load the entry stored for key with its body mapped from disk.
+     *
+     * @param key QByteArray
+     * @return std::shared_ptr<CacheEntry> null if nothing is stored or the body is missing.
+     */
+    std::shared_ptr<CacheEntry> load(const QByteArray &key);
+
+    /**
+     * @brief Store entry, replacing what is stored for its key. If the same body is already
+     * stored for the key only the metadata is replaced.
+     *
+     * @param entry CacheEntry
+     * @return bool false if the body or the index could not be written.
+     */
+    bool save(const CacheEntry &entry);
+
+    /**
+     * @brief Remove the entry stored for key.
+     *
+     * @param key QByteArray
+     */
+    void remove(const QByteArray &key);
+
+    /**
+     * @brief Remove all entries.
+     *
+     */
+    void clear();
+
+   private:
+    // What the index records about an entry; the body lives in the file named by hash.
+    struct Record {
+        CacheEntry entry;  // without body
+        QByteArray hash;   // hex SHA-256 of the body
+        qint64 size = 0;   // body size
+        qint64 lastUsed = 0;
+    };
+
+    mutable std::mutex mutex;
+    const QString directory;
+    qint64 budget;
+    qint64 bytes = 0;                   // sum of the sizes of distinct bodies
+    QHash<QByteArray, Record> records;  // by key
+    QHash<QByteArray, int> references;  // entries per body hash
+    // A body file mapped into memory. Closing the file unmaps it.
+    struct Mapping {
+        QFile file;
+        QByteArray body;  // raw data over the mapping
+        explicit Mapping(const QString &path) : file(path) {}
+    };
+    QHash<QByteArray, std::weak_ptr<Mapping>> mapped;  // by body hash, owned by the responses
+
+    // Reads the index and drops entries whose body is missing. Requires mutex.
+    void open();
+
+    // Writes the index atomically. Requires mutex.
+    bool writeIndex() const;
+
+    // Removes the record of key and its body if no other record uses it. Requires mutex.
+    void erase(const QByteArray &key);
+
+    // Evicts least recently used records until the bodies fit the budget. Requires mutex.
+    void evict();
+
+    // Points the body of response at the mapped file of hash and makes response hold the
+    // mapping. Returns false if the file is missing or has not the expected size. Requires mutex.
+    bool mapBody(const QByteArray &hash, qint64 size, Response *response);
+
+    QString bodyPath(const QByteArray &hash) const;
+    QString indexPath() const;
+};
+
+#endif /* __DISKCACHE_H__ */
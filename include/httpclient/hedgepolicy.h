@@ -0,0 +1,90 @@
+#ifndef __HEDGEPOLICY_H__
+#define __HEDGEPOLICY_H__
+
+/**
+ * @file hedgepolicy.h
+ * @brief Hedged GET requests cutting the latency tail caused by occasional slow servers.
+ */
+
+#include <QString>
+#include <QList>
+#include <chrono>
+#include <mutex>
+
+/**
+ * @brief HedgePolicy decides when HttpClient sends a duplicate of a slow GET request.
+ *
+ * If a GET has not completed after the given percentile of the latencies recently observed by
+ * the client, the same request is sent again, to alternateHost if one is set. The first
+ * successful reply is used and the other one is aborted. A failed reply only completes the
+ * request once no other reply is left.
+ *
+ * Hedging starts once minSamples latencies have been observed. At most maxHedgeRatio of the
+ * GET requests are hedged, so a slow backend does not receive twice the load. The default
+ * ratio of 0 disables hedging.
+ */
+struct HedgePolicy {
+    double percentile = 0.95;                // latency percentile after which a GET is hedged
+    std::chrono::milliseconds minDelay{10};  // never hedge sooner than this
+    int minSamples = 20;                     // latencies observed before hedging starts
+    int window = 512;                        // number of recent latencies the percentile is taken from
+    double maxHedgeRatio = 0;                // fraction of GET requests that may be hedged, 0 disables hedging
+    QString alternateHost;                   // host receiving the hedge request, empty for the same host
+};
+
+/**
+ * @brief HedgeTracker keeps the recent GET latencies of a client and limits its hedge rate.
+ * Thread-safe.
+ */
+class HedgeTracker {
+   public:
+    /**
+     * @brief Construct a new HedgeTracker for policy.
+     *
+     * @param policy HedgePolicy
+     */
+    explicit HedgeTracker(const HedgePolicy &policy);
+
+    /**
+     * @brief Get the policy of this tracker.
+     *
+     * @return const HedgePolicy&
+     */
+    const HedgePolicy &policy() const;
+
+    /**
+     * @brief Record the latency of a completed GET request.
+     *
+     * @param latency std::chrono::milliseconds
+     */
+    void recordLatency(std::chrono::milliseconds latency);
+
+    /**
+     * @brief Get the delay after which a GET request is hedged.
+     *
+     * @return std::chrono::milliseconds negative while too few latencies are known.
+     */
+    std::chrono::milliseconds delay() const;
+
+    /**
+     * @brief Record a GET request that may be hedged. Adds maxHedgeRatio to the hedge budget.
+     *
+     */
+    void recordRequest();
+
+    /**
+     * @brief Take a hedge from the budget.
+     *
+     * @return bool false if the hedge rate cap has been reached.
+     */
+    bool tryHedge();
+
+   private:
+    const HedgePolicy options;
+    mutable std::mutex mutex;
+    QList<qint64> latencies;  // ring buffer of recent latencies in milliseconds
+    int next = 0;               // slot of latencies written next
+    double tokens = 0;          // hedges that may be sent
+};
+
+#endif /* __HEDGEPOLICY_H__ */
@@ -12,15 +12,118 @@
  *
  */
 
+#include <QDeadlineTimer>
 #include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QHttp2Configuration>
 #include <QImageReader>  // Requires linking to QtGui
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QObject>
+#include <QPromise>
+#include <QSet>
+#include <QStringList>
 #include <QUrl>
+#include <atomic>
+#include <chrono>
 #include <exception>
-#include <string>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#ifdef HTTPCLIENT_COROUTINES
+#include <coroutine>
+#endif
+
+class CredentialProvider;
+class HedgeTracker;
+class NetworkThread;
+class ResponseCache;
+class RetryBudget;
+class TlsSessionCache;
+struct TlsProfile;
+class QTimer;
+struct CacheEntry;
+struct HedgePolicy;
+struct RetryPolicy;
+
+/**
+ * @brief Timing breakdown of a request in nanoseconds, measured from when the request
+ * was handed to the QNetworkAccessManager. Phases that were not reached are -1.
+ */
+struct ResponseTiming {
+    qint64 requestSentNsecs = -1;  // request written to the connection (includes DNS, TCP and TLS setup)
+    qint64 firstByteNsecs = -1;    // response headers received
+    qint64 totalNsecs = -1;        // reply finished
+};
+
+/**
+ * @brief Response of a single network call. It is handed to the per-request
+ * callbacks so that each caller receives exactly the reply to its own request.
+ *
+ * Copying a Response is cheap: the body and the header list are implicitly shared.
+ *
+ * The body of a response served from a DiskCache points into a file mapping that only stays
+ * valid while a Response holding bodyStorage exists. Keep the Response, or copy the bytes with
+ * QByteArray(body.constData(), body.size()), rather than keeping a copy of body alone. The
+ * bodies returned by the syncronous methods, the success and error signals and
+ * NetworkException::what() already own their bytes.
+ */
+struct Response {
+    int statusCode = 0;                                          // HTTP status code, 0 if the server never replied
+    QByteArray reasonPhrase;                                     // HTTP reason phrase
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;  // network error reported by Qt
+    QString errorString;                                         // human readable network error
+    QByteArray body;                                             // response body
+    QList<QNetworkReply::RawHeaderPair> rawHeaders;              // response headers as received
+    ResponseTiming timing;                                       // where the time went
+    int attempts = 1;                                            // requests sent, including retries and replays
+    int retries = 0;                                             // retries made by the RetryPolicy
+    bool hedged = false;                                         // served by the hedge request of a GET
+    bool coalesced = false;                                      // shared with an identical GET already in flight
+    bool fromCache = false;                                      // served by the ResponseCache
+    bool revalidated = false;                                    // stored body confirmed by 304 Not Modified
+    bool stale = false;                                          // served from the cache past its freshness lifetime
+    bool http2 = false;                                          // received over HTTP/2 rather than HTTP/1.1
+    std::shared_ptr<const void> bodyStorage;                     // keeps a body mapped by the DiskCache valid
+
+    /**
+     * @brief Returns true if the request completed without a network error
+     * and the status code is not > 300.
+     *
+     * @return bool
+     */
+    bool ok() const;
+
+    /**
+     * @brief Get the value of a response header. The lookup is case-insensitive.
+     * Returns an empty QByteArray if the header is not present.
+     *
+     * @param name QByteArray
+     * @return QByteArray
+     */
+    QByteArray header(const QByteArray &name) const;
+
+    /**
+     * @brief Returns true if the response carries the header. The lookup is case-insensitive.
+     *
+     * @param name QByteArray
+     * @return bool
+     */
+    bool hasHeader(const QByteArray &name) const;
+
+    /**
+     * @brief Returns true if the request was aborted by one of its timeouts or its deadline.
+     * errorString then names the limit that was exceeded.
+     *
+     * @return bool
+     */
+    bool timedOut() const;
+};
+
+Q_DECLARE_METATYPE(Response)
 
 /**
  * @brief Custom exception thrown when syncronous network calls fail.
@@ -36,6 +139,14 @@ class NetworkException : public std::exception {
      */
     NetworkException(int statusCode, const QString &message);
 
+    /**
+     * @brief Construct a new NetworkException object carrying the failed response.
+     * what() returns the response body, or the network error if the body is empty.
+     *
+     * @param response
+     */
+    explicit NetworkException(const Response &response);
+
     /**
      * @brief Get the Status Code of the response.
      *
@@ -43,6 +154,13 @@ class NetworkException : public std::exception {
      */
     int getStatusCode() const;
 
+    /**
+     * @brief Get the failed response including its headers and timing.
+     *
+     * @return const Response&
+     */
+    const Response &getResponse() const;
+
     /**
      * @brief Virtual override for the std::exception.
      *
@@ -52,7 +170,128 @@ class NetworkException : public std::exception {
 
    private:
     int statusCode;       // response status
-    std::string message;  // error message
+    Response response;    // the failed response
+    QByteArray message;   // error message, the response body when there is one, owning its bytes
+};
+
+/**
+ * @brief Completion callback invoked once per request with its Response.
+ */
+using ResponseCallback = std::function<void(const Response &response)>;
+
+/**
+ * @brief Callback receiving the response body of a streaming request chunk by chunk.
+ * Return false to abort the transfer.
+ */
+using ChunkCallback = std::function<bool(const QByteArray &chunk)>;
+
+#ifdef HTTPCLIENT_COROUTINES
+/**
+ * @brief Awaitable returned by the HttpClient::*_awaitable methods. co_await suspends the
+ * coroutine until the reply has finished and resumes it with the Response on the thread the
+ * reply lives in. No nested event loop and no per-request QObject is involved.
+ *
+ * The request is sent when the awaitable is awaited, so it must be awaited exactly once.
+ */
+class ResponseAwaitable {
+   public:
+    /**
+     * @brief Construct a new ResponseAwaitable that calls start to send the request.
+     *
+     * @param start function sending the request and invoking its argument with the response
+     */
+    explicit ResponseAwaitable(std::function<void(ResponseCallback done)> start) : start(std::move(start)) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        start([this, handle](const Response &result) {
+            response = result;
+            handle.resume();
+        });
+    }
+
+    Response await_resume() {
+        return std::move(response);
+    }
+
+   private:
+    std::function<void(ResponseCallback done)> start;
+    Response response;
+};
+
+/**
+ * @brief Minimal fire-and-forget coroutine type for awaiting requests. The coroutine starts
+ * running immediately and frees itself when it completes. Exceptions escaping the coroutine
+ * terminate the program.
+ */
+struct HttpTask {
+    struct promise_type {
+        HttpTask get_return_object() noexcept {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+#endif
+
+/**
+ * @brief Options controlling how HttpClient::download writes the body to disk.
+ */
+struct DownloadOptions {
+    bool preallocate = false;  // allocate Content-Length bytes on disk before writing (posix_fallocate)
+    bool resume = false;       // keep partial downloads and resume them with Range requests
+};
+
+/**
+ * @brief Time limits of the phases of a request. A request exceeding one of them is aborted
+ * and completes with QNetworkReply::TimeoutError. Zero disables a limit.
+ */
+struct Timeouts {
+    std::chrono::milliseconds connect{0};    // DNS, TCP and TLS setup, until TLS is up or the body is being written
+    std::chrono::milliseconds firstByte{0};  // from sending the request until the response headers arrive
+    std::chrono::milliseconds idle{0};       // between two chunks of the request or response body
+    std::chrono::milliseconds total{0};      // whole request including retries
+};
+
+/**
+ * @brief Options of a single request made with HttpClient::request.
+ */
+struct RequestOptions {
+    Timeouts timeouts;  // non-zero limits override those of the client
+    QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever);  // absolute deadline, e.g. the caller's
+};
+
+/**
+ * @brief HTTP version a client negotiates with servers.
+ */
+enum class HttpVersion {
+    Http2Preferred,       // HTTP/2 if a TLS server offers it with ALPN, HTTP/1.1 otherwise
+    Http2PriorKnowledge,  // HTTP/2 without negotiation, also over cleartext (h2c)
+    Http1Only,            // HTTP/1.1 only, up to six connections per host
+};
+
+/**
+ * @brief Protocol options of a client. Over HTTP/2 all requests to a host are multiplexed as
+ * streams over one connection, whose flow control windows bound the bytes in flight.
+ * Zero keeps the default of Qt.
+ */
+struct ProtocolOptions {
+    HttpVersion version = HttpVersion::Http2Preferred;
+    quint32 sessionWindowSize = 0;  // receive window of the connection in bytes
+    quint32 streamWindowSize = 0;   // receive window of each stream in bytes
+    quint32 maxFrameSize = 0;       // largest frame accepted, 16384 to 16777215 bytes
 };
 
 /**
@@ -65,12 +304,22 @@ class NetworkException : public std::exception {
  *
  * The asyncronous methods use signals success and error to communicate when data is ready
  * or when an error occurs. The error returned is read from the request body as a QByteArray.
+ * Each asyncronous method also has an overload taking a ResponseCallback that is invoked
+ * for that request only, so many concurrent requests can share a single client.
  *
  * Each request uses the same QNetworkAccessManager instance but different QNetwork object.
  * This means you can use the same client to perform multiple subsequent requests.
+ *
+ * The syncronous methods do not spin a nested QEventLoop. They hand the request to a
+ * network thread owned by the client, which is started on first use, and block until it
+ * delivers the response. They can therefore be called from any thread, including threads
+ * without an event loop. Chunk callbacks of stream_sync run on the network thread.
  */
 class HttpClient : public QObject {
     Q_OBJECT
+    friend class HttpClientPool;
+    friend class SegmentedDownloader;
+    friend class RequestBuilder;  // times createRequest in bench/bench_request.cpp
 
    public:
     /**
@@ -96,19 +345,209 @@ class HttpClient : public QObject {
     virtual ~HttpClient();
 
     /**
-     * @brief Set the Root CA object
+     * @brief Trust the CA certificates of the PEM file certPath in all clients of the process by
+     * adding them to QSslConfiguration::defaultConfiguration(). Prefer setTlsProfile, which
+     * configures one client and parses the file once.
      *
      * @param certPath QString
      */
     static void setRootCA(QString certPath);
 
+    /**
+     * @brief Use the TLS configuration described by profile for all requests of this client.
+     * The files of the profile are parsed here, once; the configuration is shared by the
+     * requests and applied to each of them, leaving other clients untouched. Include
+     * httpclient/tlsprofile.h.
+     *
+     * @param profile TlsProfile
+     * @return bool false if the profile can not be loaded, the previous configuration is kept.
+     */
+    bool setTlsProfile(const TlsProfile &profile);
+
+    /**
+     * @brief Get the TLS profile of this client.
+     *
+     * @return TlsProfile default constructed if none is set.
+     */
+    TlsProfile tlsProfile() const;
+
     /**
      * @brief Set the Bearer Token string. This will be used to Bearer Auth.
+     * The token is shared by all clients without a CredentialProvider.
      *
      * @param jwtToken QString.
      */
     static void setBearerToken(const QString &jwtToken);
 
+    /**
+     * @brief Use provider for the Authorization header of this client instead of the token
+     * set with setBearerToken. Pass nullptr to go back to the shared token. The provider
+     * must outlive the client.
+     *
+     * @param provider CredentialProvider*
+     */
+    void setCredentialProvider(CredentialProvider *provider);
+
+    /**
+     * @brief Get the CredentialProvider of this client, nullptr if it uses the shared token.
+     *
+     * @return CredentialProvider*
+     */
+    CredentialProvider *credentialProvider() const;
+
+    /**
+     * @brief Retry transient failures of this client's requests according to policy.
+     * Requests already running keep the policy they started with. A new retry budget is
+     * started with every call. Include httpclient/retrypolicy.h to build a policy.
+     *
+     * @param policy RetryPolicy
+     */
+    void setRetryPolicy(const RetryPolicy &policy);
+
+    /**
+     * @brief Get the retry policy of this client. The default makes a single attempt.
+     *
+     * @return RetryPolicy
+     */
+    RetryPolicy retryPolicy() const;
+
+    /**
+     * @brief Hedge slow GET requests of this client according to policy. A new latency window
+     * and hedge budget are started with every call. Include httpclient/hedgepolicy.h to build
+     * a policy.
+     *
+     * @param policy HedgePolicy
+     */
+    void setHedgePolicy(const HedgePolicy &policy);
+
+    /**
+     * @brief Get the hedge policy of this client. By default GET requests are not hedged.
+     *
+     * @return HedgePolicy
+     */
+    HedgePolicy hedgePolicy() const;
+
+    /**
+     * @brief Serve GET requests of this client from cache while its responses are fresh and
+     * store cacheable responses in it. Responses allowing stale-while-revalidate are served stale
+     * while refreshed in the background, and responses allowing stale-if-error stand in for
+     * errors of the origin. Pass nullptr to disable caching. The cache can be shared
+     * by several clients and must outlive them. Include httpclient/responsecache.h.
+     *
+     * @param cache ResponseCache*
+     */
+    void setCache(ResponseCache *cache);
+
+    /**
+     * @brief Get the cache of this client, nullptr if responses are not cached.
+     *
+     * @return ResponseCache*
+     */
+    ResponseCache *cache() const;
+
+    /**
+     * @brief Keep the TLS sessions of the connections of this client in sessions, so new
+     * connections to a host offer the last session and resume it with an abbreviated handshake.
+     * Pass nullptr to disable resumption across connections. The cache can be shared by several
+     * clients and must outlive them. Include httpclient/tlssessioncache.h.
+     *
+     * @param sessions TlsSessionCache*
+     */
+    void setTlsSessionCache(TlsSessionCache *sessions);
+
+    /**
+     * @brief Get the TLS session cache of this client, nullptr if there is none.
+     *
+     * @return TlsSessionCache*
+     */
+    TlsSessionCache *tlsSessionCache() const;
+
+    /**
+     * @brief Let identical concurrent GET requests share one reply. A GET with the same URL and
+     * request headers as a GET of this client still in flight on the same thread is not sent;
+     * it completes with the response of the request in flight, whose body is implicitly shared.
+     * Such requests inherit the timeouts and deadline of the request they joined.
+     * Disabled by default.
+     *
+     * @param enabled bool
+     */
+    void setCoalescing(bool enabled);
+
+    /**
+     * @brief Returns true if identical concurrent GET requests share one reply.
+     *
+     * @return bool
+     */
+    bool coalescing() const;
+
+    /**
+     * @brief Set the timeouts of all requests of this client, including streams and downloads.
+     * By default no timeouts are set.
+     *
+     * @param timeouts Timeouts
+     */
+    void setTimeouts(const Timeouts &timeouts);
+
+    /**
+     * @brief Get the timeouts of this client.
+     *
+     * @return Timeouts
+     */
+    Timeouts timeouts() const;
+
+    /**
+     * @brief Set the HTTP version and the HTTP/2 flow control of all requests of this client.
+     * By default HTTP/2 is used when a TLS server offers it. Response::http2 reports the
+     * protocol that was used.
+     *
+     * @param options ProtocolOptions
+     */
+    void setProtocolOptions(const ProtocolOptions &options);
+
+    /**
+     * @brief Get the protocol options of this client.
+     *
+     * @return ProtocolOptions
+     */
+    ProtocolOptions protocolOptions() const;
+
+    /**
+     * @brief Open connections to origins ahead of the first request, so it does not pay for DNS,
+     * TCP and TLS setup inline, and keep at least connections connections per origin open from
+     * then on. Calling it again with zero connections stops keeping the origins warm. Origins are
+     * URLs such as "https://api.mysite.com", only their scheme, host and port are used.
+     *
+     * The connections serve the asyncronous requests of the thread of this client. Over HTTP/2
+     * a single connection carries all requests to an origin. Can be called from any thread.
+     *
+     * @param origins QStringList
+     * @param connections int
+     */
+    void prewarm(const QStringList &origins, int connections = 1);
+
+    /**
+     * @brief Set a default http header that is added to every request of this client.
+     * Headers are encoded once here rather than for every request.
+     *
+     * @param name QString
+     * @param value QString
+     */
+    void setDefaultHeader(const QString &name, const QString &value);
+
+    /**
+     * @brief Replace all default http headers of this client.
+     *
+     * @param headers QMap<QString, QString>
+     */
+    void setDefaultHeaders(const QMap<QString, QString> &headers);
+
+    /**
+     * @brief Get the default http headers of this client.
+     *
+     * @return QMap<QString, QString>
+     */
+    QMap<QString, QString> defaultHeaders() const;
+
     /**
      * @brief Perform a GET request asyncronously. You will need to access the response by connecting
      * to the success signal and error to error signal.
@@ -152,6 +591,159 @@ class HttpClient : public QObject {
      */
     void del(const QString &url) noexcept;
 
+    /**
+     * @brief Perform a GET request asyncronously and invoke callback with its response.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @param callback ResponseCallback
+     */
+    void get(const QString &url, ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a POST request asyncronously and invoke callback with its response.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @param callback ResponseCallback
+     */
+    void post(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a PUT request asyncronously and invoke callback with its response.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @param callback ResponseCallback
+     */
+    void put(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a PATCH request asyncronously and invoke callback with its response.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @param callback ResponseCallback
+     */
+    void patch(const QString &url, const QByteArray &data, ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a DELETE request asyncronously and invoke callback with its response.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @param callback ResponseCallback
+     */
+    void del(const QString &url, ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a request with any http method asyncronously and invoke callback with its
+     * response. options can tighten the client's timeouts and carry a deadline propagated from
+     * the caller, after which the request is aborted and no retry is started.
+     *
+     * @param method QByteArray
+     * @param url QString
+     * @param data QByteArray
+     * @param options RequestOptions
+     * @param callback ResponseCallback
+     */
+    void request(const QByteArray &method, const QString &url, const QByteArray &data, const RequestOptions &options,
+                 ResponseCallback callback) noexcept;
+
+    /**
+     * @brief Perform a GET request asyncronously and return a future of its response.
+     * The future can be chained with QFuture::then or combined with QtFuture::whenAll.
+     * The success and error signals are not emitted for this request.
+     *
+     * @param url QString
+     * @return QFuture<Response>
+     */
+    QFuture<Response> get_future(const QString &url) noexcept;
+
+    /**
+     * @brief Perform a POST request asyncronously and return a future of its response.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> post_future(const QString &url, const QByteArray &data) noexcept;
+
+    /**
+     * @brief Perform a PUT request asyncronously and return a future of its response.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> put_future(const QString &url, const QByteArray &data) noexcept;
+
+    /**
+     * @brief Perform a PATCH request asyncronously and return a future of its response.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> patch_future(const QString &url, const QByteArray &data) noexcept;
+
+    /**
+     * @brief Perform a DELETE request asyncronously and return a future of its response.
+     *
+     * @param url QString
+     * @return QFuture<Response>
+     */
+    QFuture<Response> del_future(const QString &url) noexcept;
+
+#ifdef HTTPCLIENT_COROUTINES
+    /**
+     * @brief Perform a GET request when awaited: auto response = co_await client.get_awaitable(url);
+     * Requires building with HTTPCLIENT_COROUTINES.
+     *
+     * @param url QString
+     * @return ResponseAwaitable
+     */
+    ResponseAwaitable get_awaitable(const QString &url);
+
+    /**
+     * @brief Perform a POST request when awaited. Requires building with HTTPCLIENT_COROUTINES.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return ResponseAwaitable
+     */
+    ResponseAwaitable post_awaitable(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a PUT request when awaited. Requires building with HTTPCLIENT_COROUTINES.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return ResponseAwaitable
+     */
+    ResponseAwaitable put_awaitable(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a PATCH request when awaited. Requires building with HTTPCLIENT_COROUTINES.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return ResponseAwaitable
+     */
+    ResponseAwaitable patch_awaitable(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a DELETE request when awaited. Requires building with HTTPCLIENT_COROUTINES.
+     *
+     * @param url QString
+     * @return ResponseAwaitable
+     */
+    ResponseAwaitable del_awaitable(const QString &url);
+#endif
+
     /** Perform syncronous GET request and block until the response arrives
      * Returns data in request body if successful or throws a NetworkException if it fails.
      * You must catch this error to avoid segmentation faults.
@@ -182,17 +774,246 @@ class HttpClient : public QObject {
      */
     QByteArray del_sync(const QString &url);
 
+    /** Perform syncronous request with any http method and block until the response arrives.
+     * Returns the full response including status, headers and timing if successful or throws
+     * a NetworkException carrying the response if it fails.
+     * You must catch this error to avoid segmentation faults.
+     */
+    Response request_sync(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray());
+
+    /** Perform syncronous request with any http method and options, see request().
+     * Blocks until the response arrives or the deadline of options passes.
+     * Throws a NetworkException carrying the response if it fails or times out.
+     * You must catch this error to avoid segmentation faults.
+     */
+    Response request_sync(const QByteArray &method, const QString &url, const QByteArray &data,
+                          const RequestOptions &options);
+
+    /**
+     * @brief Perform a GET request asyncronously and hand the response body to onChunk
+     * as it arrives instead of buffering it. At most streamBufferSize() bytes are held
+     * in memory at any time. onFinished is invoked once the transfer is complete; the
+     * body of its response is empty unless the request failed, in which case it holds
+     * the first MiB of the error body.
+     *
+     * @param url QString
+     * @param onChunk ChunkCallback
+     * @param onFinished ResponseCallback
+     */
+    void stream(const QString &url, ChunkCallback onChunk, ResponseCallback onFinished = nullptr) noexcept;
+
+    /**
+     * @brief Perform a GET request asyncronously and write the response body to sink as
+     * it arrives. The sink must be open for writing and outlive the request. The transfer
+     * is aborted if writing to the sink fails.
+     *
+     * @param url QString
+     * @param sink QIODevice*
+     * @param onFinished ResponseCallback
+     */
+    void stream(const QString &url, QIODevice *sink, ResponseCallback onFinished = nullptr) noexcept;
+
+    /** Perform syncronous streaming GET request and block until the transfer completes.
+     * The body is handed to onChunk as it arrives. Throws a NetworkException if the request fails.
+     * You must catch this error to avoid segmentation faults.
+     */
+    void stream_sync(const QString &url, ChunkCallback onChunk);
+
+    /**
+     * @brief Download url asyncronously to path. The body is written to a temporary file
+     * as it arrives and atomically renamed to path once the transfer succeeds, so path never
+     * holds a partial download. onFinished receives a response with an empty body on success.
+     *
+     * With DownloadOptions::resume the body is written to path + ".part" and the progress is
+     * recorded in a small journal next to it (path + ".part.journal") together with the ETag or
+     * Last-Modified validator. A later download of the same url to the same path only requests
+     * the missing bytes using Range and If-Range; if the resource has changed the server sends
+     * the full body and the download starts over. Preallocation is ignored when resuming.
+     *
+     * @param url QString
+     * @param path QString
+     * @param onFinished ResponseCallback
+     * @param options DownloadOptions
+     */
+    void download(const QString &url, const QString &path, ResponseCallback onFinished = nullptr,
+                  const DownloadOptions &options = DownloadOptions()) noexcept;
+
+    /** Perform syncronous download of url to path and block until the transfer completes.
+     * Throws a NetworkException if the request fails or the file can not be written.
+     * You must catch this error to avoid segmentation faults.
+     */
+    void download_sync(const QString &url, const QString &path, const DownloadOptions &options = DownloadOptions());
+
+    /**
+     * @brief Set the maximum number of body bytes buffered per streaming request.
+     * Defaults to 256 KiB.
+     *
+     * @param bytes qint64
+     */
+    void setStreamBufferSize(qint64 bytes);
+
+    /**
+     * @brief Get the maximum number of body bytes buffered per streaming request.
+     *
+     * @return qint64
+     */
+    qint64 streamBufferSize() const;
+
    private:
     QNetworkAccessManager *manager;
     QMap<QString, QString> headers;
+    mutable std::mutex headersMutex;  // serializes changes to headers
+
+    // Default headers encoded once, swapped atomically so that requests built on other
+    // threads always see a complete block.
+    using HeaderBlock = QList<QPair<QByteArray, QByteArray>>;
+    std::shared_ptr<const HeaderBlock> encodedHeaders = std::make_shared<const HeaderBlock>();
+    void encodeHeaders();
+
+    qint64 bufferSize = 256 * 1024;  // read buffer size of streaming replies
+
+    // Timeouts of all requests, swapped atomically.
+    std::shared_ptr<const Timeouts> limits = std::make_shared<const Timeouts>();
+
+    // Protocol options with the HTTP/2 configuration built from them, swapped atomically.
+    struct Protocol {
+        ProtocolOptions options;
+        QHttp2Configuration http2 = QNetworkRequest().http2Configuration();
+    };
+    std::shared_ptr<const Protocol> protocol = std::make_shared<const Protocol>();
+
+    // Origins kept warm by prewarm() with their number of connections, and the timer reopening
+    // the connections Qt closed for being idle. Used on the thread of the client only.
+    QHash<QString, int> warmOrigins;
+    QTimer *keepWarmTimer = nullptr;
+    void warmConnections();
+
+    // Runs the syncronous requests. Created once by execute(), read from any thread and
+    // deleted first by the destructor.
+    std::atomic<NetworkThread *> syncThread{nullptr};
+    std::once_flag syncThreadStarted;
     void setHeaders(QNetworkRequest *request);
 
-    static QString token;  // The JWT
+    std::atomic<CredentialProvider *> credentials{nullptr};  // per-client bearer token
+
+    // "Bearer <token>" of the shared token, encoded once and swapped atomically.
+    static std::shared_ptr<const QByteArray> tokenHeader;
+
+    // Retry policy and the budget shared by its retries, swapped atomically. Null without retries.
+    std::shared_ptr<const RetryPolicy> retries;
+    std::shared_ptr<RetryBudget> retryBudget;
+
+    // Latencies and hedge budget of GET requests, swapped atomically. Null without hedging.
+    std::shared_ptr<HedgeTracker> hedging;
+
+    std::atomic<ResponseCache *> responseCache{nullptr};
+    std::atomic<TlsSessionCache *> sessionCache{nullptr};
+
+    // TLS profile with the configuration parsed from it, swapped atomically. Null without profile.
+    struct Tls;
+    std::shared_ptr<const Tls> tls;
+
+    // Parses profile, or returns null and logs why it can not be loaded.
+    static std::shared_ptr<const Tls> loadTls(const TlsProfile &profile);
+
+    // GET requests in flight by flightKey(), with the callbacks of the requests that joined them.
+    std::atomic<bool> coalesce{false};
+    std::mutex flightsMutex;
+    QHash<QByteArray, QList<ResponseCallback>> flights;
+    QSet<QByteArray> refreshing;  // URLs refreshed in the background after being served stale
+
+    // Builds the request for url and applies the default headers.
+    QNetworkRequest createRequest(const QString &url);
+
+    // Sends request with the given http method through the QNetworkAccessManager of the
+    // calling thread, which is the network thread's manager for syncronous requests.
+    QNetworkReply *sendRequest(const QByteArray &method, const QNetworkRequest &request,
+                               const QByteArray &data = QByteArray());
+    QNetworkReply *sendRequest(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray());
+
+    // State of one request across replays, defined in httpclient.cpp.
+    struct Call;
+
+    // Sends the request and invokes callback with its final response. A 401 is answered by
+    // refreshing the token through the CredentialProvider and replaying the request once.
+    void dispatch(const QByteArray &method, const QNetworkRequest &request, const QByteArray &data,
+                  ResponseCallback callback);
 
-    // Used by all syncronous method to process reply, read data and return it to caller
+    // Creates the state of a request that runs on the calling thread.
+    std::shared_ptr<Call> makeCall(const QByteArray &method, const QNetworkRequest &request, const QByteArray &data,
+                                   ResponseCallback callback, const RequestOptions &options = RequestOptions());
+
+    // Replies of one attempt of a call: the request and its hedge, defined in httpclient.cpp.
+    struct Attempt;
+
+    // Sends the request of call, hedges it if it is a slow GET and hands the first successful
+    // response, or the last failed one, to finishCall.
+    void startCall(const std::shared_ptr<Call> &call);
+
+    // Sends request as one of the replies of attempt.
+    void sendAttempt(const std::shared_ptr<Call> &call, const std::shared_ptr<Attempt> &attempt,
+                     const QNetworkRequest &request);
+
+    // Completes call with response, or sends it again after a transient failure or a 401.
+    void finishCall(const std::shared_ptr<Call> &call, Response response);
+
+    // Completes a GET from the cache if a fresh response is stored. Otherwise makes the request
+    // conditional on the validators of a stale stored response and returns false.
+    bool serveFromCache(const std::shared_ptr<Call> &call);
+
+    // Stores the response of call or invalidates the stored one, and returns the response to deliver.
+    Response updateCache(const std::shared_ptr<Call> &call, const Response &response);
+
+    // Hands response to the callback of call and of the requests that joined it.
+    void completeCall(const std::shared_ptr<Call> &call, const Response &response);
+
+    // Attaches call to an identical GET in flight. Returns false if call must be sent itself,
+    // in which case it becomes the request that others join.
+    bool joinFlight(const std::shared_ptr<Call> &call);
+
+    // Schedules the next attempt of call if its retry policy and budget allow one.
+    bool scheduleRetry(const std::shared_ptr<Call> &call, const Response &response);
+
+    // Implements download() for DownloadOptions::resume.
+    void resumableDownload(const QString &url, const QString &path, ResponseCallback onFinished);
+
+    // Hands the body of reply to onChunk as it arrives and invokes onFinished once the reply
+    // has finished. Only successful responses are streamed, error bodies are kept up to 1 MiB.
+    void dispatchStream(QNetworkReply *reply, ChunkCallback onChunk, ResponseCallback onFinished);
+
+    // Sends the request and returns a future fulfilled with its response.
+    QFuture<Response> sendFuture(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray());
+
+#ifdef HTTPCLIENT_COROUTINES
+    // Returns an awaitable that sends the request once awaited.
+    ResponseAwaitable sendAwaitable(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray());
+#endif
+
+    // Returns a callback that fulfills promise with the response it receives.
+    static ResponseCallback resolve(std::shared_ptr<QPromise<Response>> promise);
+
+    // Emits the success or error signal for the legacy signal based asyncronous API.
+    void emitResponse(const Response &response);
+
+    // Reads status, headers, error and body of a finished reply.
+    static Response readResponse(QNetworkReply *reply);
+
+    // Aborts reply once it exceeds the timeouts of this client. The returned string names the
+    // limit that aborted the reply and stays empty otherwise.
+    std::shared_ptr<QString> watchClientTimeouts(QNetworkReply *reply) const;
+
+    // Returns the manager that replies created on the calling thread must use.
+    QNetworkAccessManager *threadManager() const;
+
+    // Runs start on the network thread and blocks the calling thread until start reports
+    // the response through the callback it is given.
+    Response execute(std::function<void(ResponseCallback done)> start);
+
+    // Used by all syncronous method to send the request, read the response and return it to caller
     // and is responsible for throwing the NetworkException is the reply failed or status
     // code is > 300.
-    QByteArray waitForResponse(QNetworkReply *reply);
+    Response waitForResponse(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray(),
+                             const RequestOptions &options = RequestOptions());
 
    signals:
     /**
@@ -211,13 +1032,13 @@ class HttpClient : public QObject {
      */
     void error(const QString &errorString);
 
-   private slots:
-
     /**
-     * @brief Slot for internal use to process network reply.
+     * @brief Signal which is emitted together with success or error for the signal based
+     * asyncronous methods. The full response is passed as a parameter to the slot.
      *
+     * @param response
      */
-    void onReplyFinished();
+    void responseReceived(const Response &response);
 };
 
 void writeFile(const QString &path, const QByteArray &data);
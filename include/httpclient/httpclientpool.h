@@ -0,0 +1,201 @@
+#ifndef __HTTPCLIENTPOOL_H__
+#define __HTTPCLIENTPOOL_H__
+
+/**
+ * @file httpclientpool.h
+ * @brief Thread-safe facade running HttpClient requests on a set of IO threads.
+ */
+
+#include <QFuture>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "httpclient/httpclient.h"
+
+class NetworkThread;
+
+/**
+ * @brief HttpClientPool accepts requests from any thread and runs them on one or more IO threads.
+ *
+ * Each IO thread runs its own event loop and owns a HttpClient, so connections are reused by all
+ * requests that land on the same thread. Requests are distributed over the threads round robin.
+ * Results are delivered through a QFuture that can be waited on from any thread or chained with
+ * QFuture::then.
+ *
+ * All public methods are thread-safe. Unlike HttpClient, requests never throw; inspect
+ * Response::ok() of the result instead.
+ */
+class HttpClientPool : public QObject {
+    Q_OBJECT
+
+   public:
+    /**
+     * @brief Construct a new HttpClientPool with threadCount IO threads.
+     *
+     * @param threadCount int
+     * @param parent QObject*
+     */
+    explicit HttpClientPool(int threadCount = 1, QObject *parent = nullptr);
+
+    /**
+     * @brief Construct a new HttpClientPool with threadCount IO threads whose clients add
+     * headers to every request.
+     *
+     * @param threadCount int
+     * @param headers QMap<QString, QString>
+     * @param parent QObject*
+     */
+    HttpClientPool(int threadCount, const QMap<QString, QString> &headers, QObject *parent = nullptr);
+
+    /**
+     * @brief Stop all IO threads. Requests still running are cancelled.
+     *
+     */
+    virtual ~HttpClientPool();
+
+    /**
+     * @brief Get the number of IO threads.
+     *
+     * @return int
+     */
+    int threadCount() const;
+
+    /**
+     * @brief Take the token of all IO threads from provider, see HttpClient::setCredentialProvider.
+     * Pass nullptr to fall back to the token set with HttpClient::setBearerToken.
+     *
+     * @param provider CredentialProvider*
+     */
+    void setCredentialProvider(CredentialProvider *provider);
+
+    /**
+     * @brief Retry transient failures according to policy. Each IO thread keeps its own
+     * retry budget. Include httpclient/retrypolicy.h to build a policy.
+     *
+     * @param policy RetryPolicy
+     */
+    void setRetryPolicy(const RetryPolicy &policy);
+
+    /**
+     * @brief Hedge slow GET requests according to policy. Each IO thread keeps its own latency
+     * window and hedge budget. Include httpclient/hedgepolicy.h to build a policy.
+     *
+     * @param policy HedgePolicy
+     */
+    void setHedgePolicy(const HedgePolicy &policy);
+
+    /**
+     * @brief Serve GET requests from cache, which is shared by all IO threads and must outlive
+     * the pool. Include httpclient/responsecache.h.
+     *
+     * @param cache ResponseCache*
+     */
+    void setCache(ResponseCache *cache);
+
+    /**
+     * @brief Use the TLS configuration described by profile for all requests of the pool.
+     * The files are parsed once and the configuration is shared by all IO threads.
+     *
+     * @param profile TlsProfile
+     * @return bool false if the profile can not be loaded.
+     */
+    bool setTlsProfile(const TlsProfile &profile);
+
+    /**
+     * @brief Keep the TLS sessions of all IO threads in sessions.
+     *
+     * @param sessions TlsSessionCache*
+     */
+    void setTlsSessionCache(TlsSessionCache *sessions);
+
+    /**
+     * @brief Let identical concurrent GET requests landing on the same IO thread share one reply.
+     *
+     * @param enabled bool
+     */
+    void setCoalescing(bool enabled);
+
+    /**
+     * @brief Set the timeouts of all requests of the pool.
+     *
+     * @param timeouts Timeouts
+     */
+    void setTimeouts(const Timeouts &timeouts);
+
+    /**
+     * @brief Set the protocol options of all requests of the pool.
+     *
+     * @param options ProtocolOptions
+     */
+    void setProtocolOptions(const ProtocolOptions &options);
+
+    /**
+     * @brief Open connections to origins on every IO thread ahead of the first request and keep
+     * at least connections connections per origin and thread open. See HttpClient::prewarm.
+     *
+     * @param origins QStringList
+     * @param connections int
+     */
+    void prewarm(const QStringList &origins, int connections = 1);
+
+    /**
+     * @brief Perform a GET request on one of the IO threads.
+     *
+     * @param url QString
+     * @return QFuture<Response>
+     */
+    QFuture<Response> get(const QString &url);
+
+    /**
+     * @brief Perform a POST request on one of the IO threads.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> post(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a PUT request on one of the IO threads.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> put(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a PATCH request on one of the IO threads.
+     *
+     * @param url QString
+     * @param data QByteArray
+     * @return QFuture<Response>
+     */
+    QFuture<Response> patch(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Perform a DELETE request on one of the IO threads.
+     *
+     * @param url QString
+     * @return QFuture<Response>
+     */
+    QFuture<Response> del(const QString &url);
+
+   private:
+    struct Worker {
+        std::unique_ptr<NetworkThread> thread;
+        HttpClient *client = nullptr;  // lives on thread
+    };
+
+    std::vector<Worker> workers;
+    std::atomic<unsigned> nextWorker{0};
+
+    // Hands the request to the next IO thread and returns the future of its response.
+    QFuture<Response> send(const QByteArray &method, const QString &url, const QByteArray &data = QByteArray());
+};
+
+#endif /* __HTTPCLIENTPOOL_H__ */
@@ -0,0 +1,77 @@
+#ifndef __NETWORKTHREAD_H__
+#define __NETWORKTHREAD_H__
+
+/**
+ * @file networkthread.h
+ * @brief A thread running its own event loop and QNetworkAccessManager.
+ */
+
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QThread>
+#include <utility>
+
+/**
+ * @brief NetworkThread owns a QThread with a running event loop and a QNetworkAccessManager
+ * that lives on it. Work is handed to the thread with post() and runs there, so replies
+ * created by that work are driven by the thread's event loop rather than the caller's.
+ *
+ * This lets blocking calls wait on a future fulfilled from the network thread instead of
+ * spinning a nested QEventLoop, which makes them usable from any thread.
+ */
+class NetworkThread {
+   public:
+    /**
+     * @brief Start the thread and create its QNetworkAccessManager.
+     *
+     * @param name QString used as the thread's object name.
+     */
+    explicit NetworkThread(const QString &name = "httpclient-network");
+
+    /**
+     * @brief Stop the thread. Replies still running on it are destroyed with its manager.
+     *
+     */
+    ~NetworkThread();
+
+    NetworkThread(const NetworkThread &) = delete;
+    NetworkThread &operator=(const NetworkThread &) = delete;
+
+    /**
+     * @brief The QNetworkAccessManager living on the thread. Only use it from the thread itself.
+     *
+     * @return QNetworkAccessManager*
+     */
+    QNetworkAccessManager *manager() const;
+
+    /**
+     * @brief Object living on the thread, usable as the context of connections and timers.
+     *
+     * @return QObject*
+     */
+    QObject *context() const;
+
+    /**
+     * @brief Returns true if called from the network thread.
+     *
+     * @return bool
+     */
+    bool isCurrentThread() const;
+
+    /**
+     * @brief Run function on the network thread. Safe to call from any thread.
+     *
+     * @param function callable without arguments
+     */
+    template <typename Function>
+    void post(Function &&function) {
+        QMetaObject::invokeMethod(worker, std::forward<Function>(function), Qt::QueuedConnection);
+    }
+
+   private:
+    QThread thread;
+    QObject *worker;  // lives on thread and owns networkManager
+    QNetworkAccessManager *networkManager = nullptr;
+};
+
+#endif /* __NETWORKTHREAD_H__ */
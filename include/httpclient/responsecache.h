@@ -0,0 +1,295 @@
+#ifndef __RESPONSECACHE_H__
+#define __RESPONSECACHE_H__
+
+/**
+ * @file responsecache.h
+ * @brief In-memory HTTP cache for HttpClient following the caching rules of RFC 9111.
+ */
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QNetworkRequest>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include "httpclient/httpclient.h"
+
+class DiskCache;
+
+/**
+ * @brief A stored response together with what is needed to compute its age and to select it.
+ */
+struct CacheEntry {
+    QByteArray key;                                        // request URL without fragment
+    Response response;                                     // status, headers and body as received
+    QList<QPair<QByteArray, QByteArray>> varyHeaders;      // request headers named by Vary, with their values
+    QByteArray credential;                                 // SHA-256 of the request's Authorization, if any
+    QDateTime responseTime;                                // when the response was received
+    qint64 initialAge = 0;                                 // corrected initial age in seconds (RFC 9111 4.2.3)
+    qint64 freshnessLifetime = 0;                          // seconds the response is fresh (RFC 9111 4.2.1)
+    qint64 staleWhileRevalidate = 0;                       // seconds it may be served stale while refreshed
+    qint64 staleIfError = 0;                               // seconds it may be served stale on origin errors
+
+    /**
+     * @brief Get the current age of the response in seconds.
+     *
+     * @param now QDateTime
+     * @return qint64
+     */
+    qint64 age(const QDateTime &now) const;
+
+    /**
+     * @brief Returns true if the response may be served without contacting the origin.
+     *
+     * @param now QDateTime
+     * @return bool
+     */
+    bool isFresh(const QDateTime &now) const;
+
+    /**
+     * @brief Returns true if the response may be served while it is revalidated in the
+     * background, because it is fresh or within its stale-while-revalidate window.
+     *
+     * @param now QDateTime
+     * @return bool
+     */
+    bool isUsableWhileRevalidating(const QDateTime &now) const;
+
+    /**
+     * @brief Returns true if the response may be served instead of an error of the origin,
+     * because it is fresh or within its stale-if-error window.
+     *
+     * @param now QDateTime
+     * @return bool
+     */
+    bool isUsableOnError(const QDateTime &now) const;
+
+    /**
+     * @brief Get the number of bytes the entry is accounted for in the cache budget.
+     *
+     * @return qint64
+     */
+    qint64 cost() const;
+};
+
+/**
+ * @brief ResponseCache stores GET responses of one or more HttpClient instances in memory.
+ *
+ * Responses are stored according to their Cache-Control (max-age, s-maxage, no-store, no-cache,
+ * private, public) and Expires headers, or heuristically from Last-Modified. Responses carrying
+ * "Vary: *" are not stored; otherwise a stored response is only used for requests sending the
+ * same values of the headers named by Vary. A request with "Cache-Control: no-store" or
+ * "no-cache" bypasses the cache. Successful unsafe requests (POST, PUT, PATCH, DELETE)
+ * invalidate the stored response of their URL.
+ *
+ * Stale responses carrying an ETag or Last-Modified validator are kept, so HttpClient can
+ * revalidate them with a conditional request and reuse the stored body on 304 Not Modified.
+ * The stale-while-revalidate and stale-if-error extensions (RFC 5861) let HttpClient serve a
+ * stale response immediately while refreshing it, or instead of an error of the origin, unless
+ * the response is marked no-cache, must-revalidate or, in a shared cache, proxy-revalidate.
+ *
+ * The least recently used responses are evicted once the stored bodies and headers exceed
+ * maxBytes. A shared cache, which may serve several users, does not store responses marked
+ * private or responses to requests with an Authorization header unless the response allows it.
+ *
+ * A response to a request with an Authorization header is only used for requests sending the
+ * same Authorization value, as if the response varied on it, so clients with different
+ * credentials never see each other's responses. Only a hash of the value is kept. Each URL
+ * still holds one response, so clients alternating credentials on a URL replace each other's.
+ *
+ * All methods are thread-safe. Entries are immutable and handed out as shared pointers.
+ */
+class ResponseCache {
+   public:
+    /**
+     * @brief Construct a new private ResponseCache holding up to maxBytes.
+     *
+     * @param maxBytes qint64
+     */
+    explicit ResponseCache(qint64 maxBytes = 64 * 1024 * 1024);
+
+    /**
+     * @brief Set the byte budget and evict entries exceeding it.
+     *
+     * @param bytes qint64
+     */
+    void setMaxBytes(qint64 bytes);
+
+    /**
+     * @brief Get the byte budget.
+     *
+     * @return qint64
+     */
+    qint64 maxBytes() const;
+
+    /**
+     * @brief Get the number of bytes currently stored.
+     *
+     * @return qint64
+     */
+    qint64 size() const;
+
+    /**
+     * @brief Treat the cache as shared between users (RFC 9111 "shared cache"). Defaults to false.
+     *
+     * @param shared bool
+     */
+    void setShared(bool shared);
+
+    /**
+     * @brief Returns true if the cache is shared between users.
+     *
+     * @return bool
+     */
+    bool isShared() const;
+
+    /**
+     * @brief Add a persistent tier behind the memory cache. Responses are written through to
+     * disk and memory misses are loaded from it. Pass nullptr to remove the tier. The
+     * DiskCache must outlive this cache.
+     *
+     * @param disk DiskCache*
+     */
+    void setDiskCache(DiskCache *disk);
+
+    /**
+     * @brief Get the persistent tier, nullptr if there is none.
+     *
+     * @return DiskCache*
+     */
+    DiskCache *diskCache() const;
+
+    /**
+     * @brief Get the stored response matching request, fresh or stale, and count a hit if it
+     * may be served without waiting for the origin or a miss otherwise.
+     *
+     * @param request QNetworkRequest
+     * @return std::shared_ptr<const CacheEntry> null if nothing usable is stored.
+     */
+    std::shared_ptr<const CacheEntry> lookup(const QNetworkRequest &request);
+
+    /**
+     * @brief Store the response to a GET request if it is cacheable, replacing what is stored
+     * for the URL.
+     *
+     * @param request QNetworkRequest
+     * @param response Response
+     * @param requestTime QDateTime when the request was sent
+     * @return bool true if the response was stored.
+     */
+    bool store(const QNetworkRequest &request, const Response &response, const QDateTime &requestTime);
+
+    /**
+     * @brief Freshen a stale stored response after the origin answered its conditional request
+     * with 304 Not Modified (RFC 9111 4.3.4). The headers of notModified replace the stored ones
+     * and the updated response is stored again.
+     *
+     * @param request QNetworkRequest
+     * @param stale CacheEntry the stored response that was revalidated
+     * @param notModified Response the 304 response
+     * @param requestTime QDateTime when the conditional request was sent
+     * @return Response the stored response with updated headers, to be used instead of the 304.
+     */
+    Response freshen(const QNetworkRequest &request, const CacheEntry &stale, const Response &notModified,
+                     const QDateTime &requestTime);
+
+    /**
+     * @brief Add If-None-Match and If-Modified-Since headers for the validators of entry to
+     * request, so the origin can answer with 304 Not Modified.
+     *
+     * @param request QNetworkRequest*
+     * @param entry CacheEntry
+     * @return bool false if entry has no validator.
+     */
+    static bool addValidators(QNetworkRequest *request, const CacheEntry &entry);
+
+    /**
+     * @brief Remove the stored response of url.
+     *
+     * @param url QUrl
+     */
+    void invalidate(const QUrl &url);
+
+    /**
+     * @brief Remove all stored responses.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of lookups answered with a fresh response or a stale one within
+     * its stale-while-revalidate window.
+     *
+     * @return qint64
+     */
+    qint64 hits() const;
+
+    /**
+     * @brief Get the number of lookups that had to go to the network.
+     *
+     * @return qint64
+     */
+    qint64 misses() const;
+
+    /**
+     * @brief Get the number of stale responses the origin confirmed with 304 Not Modified.
+     *
+     * @return qint64
+     */
+    qint64 revalidations() const;
+
+    /**
+     * @brief Parse a Cache-Control header into lower case directives and their unquoted values.
+     *
+     * @param value QByteArray
+     * @return QHash<QByteArray, QByteArray>
+     */
+    static QHash<QByteArray, QByteArray> parseCacheControl(const QByteArray &value);
+
+    /**
+     * @brief Parse an HTTP date (IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT").
+     *
+     * @param value QByteArray
+     * @return QDateTime invalid if value is not a date.
+     */
+    static QDateTime parseHttpDate(const QByteArray &value);
+
+   private:
+    using Entries = std::list<std::shared_ptr<const CacheEntry>>;  // most recently used first
+
+    mutable std::mutex mutex;
+    Entries entries;
+    QHash<QByteArray, Entries::iterator> index;  // entries by key
+    qint64 budget;
+    qint64 bytes = 0;
+    bool shared = false;
+    std::atomic<DiskCache *> disk{nullptr};
+    std::atomic<qint64> hitCount{0};
+    std::atomic<qint64> missCount{0};
+    std::atomic<qint64> revalidationCount{0};
+
+    // Builds the entry for response, or returns null if it must not be stored.
+    std::shared_ptr<CacheEntry> makeEntry(const QNetworkRequest &request, const Response &response,
+                                          const QDateTime &requestTime) const;
+
+    // Makes entry the most recently used one, replacing what is stored for its key. Requires mutex.
+    void insert(std::shared_ptr<const CacheEntry> entry);
+
+    // Removes the entry at it. Requires mutex.
+    void erase(Entries::iterator it);
+
+    // Evicts least recently used entries until bytes fits the budget. Requires mutex.
+    void evict();
+
+    // Key of the entries of url.
+    static QByteArray keyOf(const QUrl &url);
+
+    // Identity of the Authorization header of request, empty if it has none.
+    static QByteArray credentialOf(const QNetworkRequest &request);
+};
+
+#endif /* __RESPONSECACHE_H__ */
@@ -0,0 +1,117 @@
+#ifndef __RETRYPOLICY_H__
+#define __RETRYPOLICY_H__
+
+/**
+ * @file retrypolicy.h
+ * @brief Retries of transient failures with exponential backoff, jitter and a retry budget.
+ */
+
+#include <QByteArray>
+#include <QList>
+#include <QNetworkRequest>
+#include <chrono>
+#include <mutex>
+
+#include "httpclient/httpclient.h"
+
+/**
+ * @brief RetryPolicy decides which failed requests HttpClient sends again and when.
+ *
+ * A failure is transient if the server answered with one of retryableStatusCodes or the
+ * connection failed (refused, reset, timed out, host lookup failed). Transient failures of
+ * idempotent requests are retried up to maxAttempts - 1 times. A request is idempotent if its
+ * method is listed in idempotentMethods or it carries an Idempotency-Key header. Requests that
+ * never reached the server (connection refused, host not found) are retried for every method.
+ *
+ * The delay before retry n is drawn uniformly from [0, min(maxDelay, baseDelay * 2^(n-1))]
+ * ("full jitter"), so clients failing together do not retry together. A Retry-After header
+ * of the response overrides the delay; if it asks for more than maxDelay the request is not
+ * retried.
+ *
+ * The default policy makes a single attempt, which disables retries.
+ */
+struct RetryPolicy {
+    int maxAttempts = 1;                         // requests sent at most, including the first
+    std::chrono::milliseconds baseDelay{100};    // backoff before the first retry
+    std::chrono::milliseconds maxDelay{10000};   // upper bound of the backoff and of Retry-After
+    QList<QByteArray> idempotentMethods{"GET", "HEAD", "OPTIONS", "TRACE", "PUT", "DELETE"};
+    QList<int> retryableStatusCodes{408, 429, 502, 503, 504};
+    double budgetTokens = 10;   // capacity of the retry budget, see RetryBudget
+    double budgetRefill = 0.1;  // tokens returned to the budget by each successful response
+
+    /**
+     * @brief Returns true if response is a failure that may go away when the request is
+     * sent again.
+     *
+     * @param response Response
+     * @return bool
+     */
+    bool isTransient(const Response &response) const;
+
+    /**
+     * @brief Returns true if the request may be sent again after it failed with response.
+     *
+     * @param method QByteArray
+     * @param request QNetworkRequest
+     * @param response Response
+     * @return bool
+     */
+    bool canRetry(const QByteArray &method, const QNetworkRequest &request, const Response &response) const;
+
+    /**
+     * @brief Get the delay before retry number retry (starting at 1) after response.
+     *
+     * @param retry int
+     * @param response Response
+     * @return std::chrono::milliseconds negative if Retry-After exceeds maxDelay.
+     */
+    std::chrono::milliseconds backoff(int retry, const Response &response) const;
+
+    /**
+     * @brief Read the Retry-After header of response, given either in seconds or as an
+     * HTTP date.
+     *
+     * @param response Response
+     * @return std::chrono::milliseconds negative if the header is missing or invalid.
+     */
+    static std::chrono::milliseconds retryAfter(const Response &response);
+};
+
+/**
+ * @brief RetryBudget is a token bucket limiting retries so that they can not amplify an outage.
+ *
+ * Every transient failure takes a token and every successful response returns a fraction of
+ * one. Retries are only allowed while more than half of the tokens are left, so when most
+ * requests fail the client stops retrying until successes refill the bucket. Thread-safe.
+ */
+class RetryBudget {
+   public:
+    /**
+     * @brief Construct a new full RetryBudget.
+     *
+     * @param capacity double
+     * @param refill double tokens returned per success
+     */
+    RetryBudget(double capacity, double refill);
+
+    /**
+     * @brief Record a transient failure.
+     *
+     * @return bool true if the failed request may be retried.
+     */
+    bool recordFailure();
+
+    /**
+     * @brief Record a successful response.
+     *
+     */
+    void recordSuccess();
+
+   private:
+    std::mutex mutex;
+    const double capacity;
+    const double refill;
+    double tokens;
+};
+
+#endif /* __RETRYPOLICY_H__ */
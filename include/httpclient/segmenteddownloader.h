@@ -0,0 +1,103 @@
+#ifndef __SEGMENTEDDOWNLOADER_H__
+#define __SEGMENTEDDOWNLOADER_H__
+
+/**
+ * @file segmenteddownloader.h
+ * @brief Parallel ranged downloads on top of HttpClient.
+ */
+
+#include <QObject>
+#include <QString>
+
+#include "httpclient/httpclient.h"
+
+/**
+ * @brief SegmentedDownloader downloads a single resource over several connections at once.
+ *
+ * A HEAD request is used to learn Content-Length and Accept-Ranges. If the server supports
+ * byte ranges the body is split into segments that are fetched with concurrent Range requests
+ * through the client's QNetworkAccessManager and written at their offsets in the target file.
+ * Segments are requested over HTTP/1.1, so each gets a connection of its own.
+ * Otherwise the download falls back to a single HttpClient::download stream.
+ *
+ * As with HttpClient::download, the body is written to a temporary file that is atomically
+ * renamed to the target path once every segment has completed.
+ */
+class SegmentedDownloader : public QObject {
+    Q_OBJECT
+
+   public:
+    /**
+     * @brief Construct a new SegmentedDownloader using client for all requests.
+     * The client must outlive the downloader.
+     *
+     * @param client HttpClient*
+     * @param parent QObject*
+     */
+    SegmentedDownloader(HttpClient *client, QObject *parent = nullptr);
+
+    /**
+     * @brief Set the maximum number of concurrent connections per download. Defaults to 4.
+     * QNetworkAccessManager opens at most 6 HTTP/1.1 connections per host, larger values are
+     * clamped to maxHttp1Connections with a warning.
+     *
+     * @param connections int
+     */
+    void setConnections(int connections);
+
+    /// Connections QNetworkAccessManager opens per host and scheme for HTTP/1.1.
+    static constexpr int maxHttp1Connections = 6;
+
+    /**
+     * @brief Get the maximum number of concurrent connections per download.
+     *
+     * @return int
+     */
+    int connections() const;
+
+    /**
+     * @brief Set the smallest segment worth its own connection. Files smaller than twice
+     * this size are downloaded with a single stream. Defaults to 1 MiB.
+     *
+     * @param bytes qint64
+     */
+    void setMinimumSegmentSize(qint64 bytes);
+
+    /**
+     * @brief Get the smallest segment worth its own connection.
+     *
+     * @return qint64
+     */
+    qint64 minimumSegmentSize() const;
+
+    /**
+     * @brief Download url asyncronously to path using up to connections() concurrent range
+     * requests. onFinished receives a response with an empty body on success.
+     *
+     * @param url QString
+     * @param path QString
+     * @param onFinished ResponseCallback
+     */
+    void download(const QString &url, const QString &path, ResponseCallback onFinished = nullptr) noexcept;
+
+    /** Perform syncronous segmented download of url to path and block until it completes.
+     * Throws a NetworkException if the request fails or the file can not be written.
+     * You must catch this error to avoid segmentation faults.
+     */
+    void download_sync(const QString &url, const QString &path);
+
+   private:
+    struct Transfer;
+
+    HttpClient *client;
+    int maxConnections = 4;
+    qint64 minSegmentSize = 1024 * 1024;
+
+    // Splits the body of length bytes into segments and starts a range request for each.
+    void startSegments(std::shared_ptr<Transfer> transfer, qint64 length, const QByteArray &validator);
+
+    // Aborts the remaining segments and reports response to the caller.
+    static void fail(const std::shared_ptr<Transfer> &transfer, const Response &response);
+};
+
+#endif /* __SEGMENTEDDOWNLOADER_H__ */
@@ -0,0 +1,43 @@
+#ifndef __TLSPROFILE_H__
+#define __TLSPROFILE_H__
+
+/**
+ * @file tlsprofile.h
+ * @brief Trust store, client certificate and protocol constraints of the TLS connections of a client.
+ */
+
+#include <QByteArray>
+#include <QSslConfiguration>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief TlsProfile describes the TLS configuration of the connections of one HttpClient.
+ *
+ * The files are read and parsed once, when the profile is installed with
+ * HttpClient::setTlsProfile. The resulting configuration is immutable, shared by all requests
+ * of the client and applied to each request, so clients with different trust stores or client
+ * certificates can live in the same process without touching
+ * QSslConfiguration::defaultConfiguration().
+ *
+ * All files are PEM encoded. Empty members keep the defaults of Qt.
+ */
+struct TlsProfile {
+    QString caBundle;                                    // CA certificates to trust, every one in the file
+    bool systemCaCertificates = true;                    // trust the system CAs in addition to caBundle
+    QString certificate;                                 // client certificate, followed by its intermediate certificates
+    QString privateKey;                                  // private key of the client certificate, RSA or EC
+    QByteArray passphrase;                               // of an encrypted private key
+    QSsl::SslProtocol protocol = QSsl::SecureProtocols;  // allowed TLS versions, e.g. QSsl::TlsV1_3OrLater
+    QStringList ciphers;                                 // OpenSSL names of the allowed cipher suites
+
+    /**
+     * @brief Read the files of the profile and build the configuration it describes.
+     *
+     * @param error QString* set to the reason if the profile can not be loaded
+     * @return QSslConfiguration null if the profile can not be loaded.
+     */
+    QSslConfiguration toSslConfiguration(QString *error = nullptr) const;
+};
+
+#endif /* __TLSPROFILE_H__ */
@@ -0,0 +1,127 @@
+#ifndef __TLSSESSIONCACHE_H__
+#define __TLSSESSIONCACHE_H__
+
+/**
+ * @file tlssessioncache.h
+ * @brief TLS sessions of HttpClient kept per host so new connections resume them.
+ */
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <mutex>
+
+/**
+ * @brief Number and duration of the TLS handshakes of the connections opened by HttpClient.
+ *
+ * Qt does not report whether a server accepted an offered session, so a handshake offering a
+ * stored session is counted as resumed. An abbreviated handshake saves a round trip and the
+ * certificate exchange, which shows as a lower mean duration than that of full handshakes.
+ */
+struct TlsHandshakeStats {
+    qint64 full = 0;          // handshakes without a stored session
+    qint64 resumed = 0;       // handshakes offering a stored session
+    qint64 fullNsecs = 0;     // total duration of the full handshakes, including TCP setup
+    qint64 resumedNsecs = 0;  // total duration of the resumed handshakes, including TCP setup
+};
+
+/**
+ * @brief TlsSessionCache keeps the TLS session ticket of the last connection to each host, so
+ * HttpClient can offer it when it connects to the host again and the server can skip the full
+ * handshake.
+ *
+ * Sessions are kept in memory, or also in a file so they survive restarts. Since a session
+ * ticket grants resumption of a session, the file is encrypted and authenticated with keys
+ * derived from a secret: HMAC-SHA256 in counter mode produces the keystream and an HMAC-SHA256
+ * tag over the random nonce and the ciphertext detects tampering. A file that can not be
+ * authenticated, for example after the secret changed, is ignored.
+ *
+ * Install it with HttpClient::setTlsSessionCache. A cache can be shared by several clients.
+ * All methods are thread-safe.
+ */
+class TlsSessionCache {
+   public:
+    /**
+     * @brief Construct a new TlsSessionCache keeping sessions in memory.
+     *
+     */
+    TlsSessionCache();
+
+    /**
+     * @brief Construct a new TlsSessionCache persisted to the encrypted file path, and load
+     * the sessions stored there.
+     *
+     * @param path QString
+     * @param secret QByteArray key material the file keys are derived from, at least 32 bytes
+     */
+    TlsSessionCache(const QString &path, const QByteArray &secret);
+
+    /**
+     * @brief Get the session ticket stored for host.
+     *
+     * @param host QString "host:port"
+     * @return QByteArray empty if there is none or it expired.
+     */
+    QByteArray ticket(const QString &host) const;
+
+    /**
+     * @brief Store the session ticket of host, replacing the stored one, and write the file.
+     *
+     * @param host QString "host:port"
+     * @param ticket QByteArray
+     * @param lifetimeHint int seconds the server keeps the ticket valid, 0 if unknown
+     */
+    void store(const QString &host, const QByteArray &ticket, int lifetimeHint);
+
+    /**
+     * @brief Remove the session ticket of host.
+     *
+     * @param host QString "host:port"
+     */
+    void remove(const QString &host);
+
+    /**
+     * @brief Remove all session tickets.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Count a TLS handshake.
+     *
+     * @param resumed bool true if a stored session was offered
+     * @param nsecs qint64 duration of the connection setup
+     */
+    void recordHandshake(bool resumed, qint64 nsecs);
+
+    /**
+     * @brief Get the handshakes counted so far.
+     *
+     * @return TlsHandshakeStats
+     */
+    TlsHandshakeStats handshakeStats() const;
+
+   private:
+    struct Session {
+        QByteArray ticket;
+        qint64 expires = 0;  // msecs since epoch
+    };
+
+    mutable std::mutex mutex;
+    QHash<QString, Session> sessions;  // by host
+    TlsHandshakeStats stats;
+    const QString path;           // empty if kept in memory only
+    QByteArray encryptionKey;     // keys of the file, derived from the secret
+    QByteArray authenticationKey;
+
+    // Reads the file, ignoring it if it can not be authenticated. Requires mutex.
+    void load();
+
+    // Writes the sessions that have not expired. Requires mutex.
+    void write() const;
+
+    // XORs data with the keystream of nonce.
+    QByteArray applyKeystream(const QByteArray &nonce, const QByteArray &data) const;
+};
+
+#endif /* __TLSSESSIONCACHE_H__ */
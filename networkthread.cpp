@@ -0,0 +1,31 @@
+#include "httpclient/networkthread.h"
+
+NetworkThread::NetworkThread(const QString &name) : worker(new QObject) {
+    thread.setObjectName(name);
+    worker->moveToThread(&thread);
+    thread.start();
+
+    // The manager must be created on the thread that drives its replies.
+    QMetaObject::invokeMethod(
+        worker, [this]() { networkManager = new QNetworkAccessManager(worker); }, Qt::BlockingQueuedConnection);
+}
+
+NetworkThread::~NetworkThread() {
+    // Deferred deletes are still processed when the thread finishes, so the worker and
+    // its manager are destroyed on the network thread.
+    worker->deleteLater();
+    thread.quit();
+    thread.wait();
+}
+
+QNetworkAccessManager *NetworkThread::manager() const {
+    return networkManager;
+}
+
+QObject *NetworkThread::context() const {
+    return worker;
+}
+
+bool NetworkThread::isCurrentThread() const {
+    return QThread::currentThread() == &thread;
+}
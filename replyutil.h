@@ -0,0 +1,35 @@
+#ifndef __REPLYUTIL_H__
+#define __REPLYUTIL_H__
+
+/**
+ * @file replyutil.h
+ * @brief Reply handling shared by HttpClient and SegmentedDownloader. Internal, not installed.
+ */
+
+#include <QByteArray>
+#include <QNetworkReply>
+#include <QString>
+
+#include "httpclient/httpclient.h"
+
+// Error bodies of streamed replies are kept for the Response up to this size, the rest is discarded.
+constexpr qsizetype maxErrorBodySize = 1024 * 1024;
+
+// Reports a reply aborted by a timeout watcher as a timeout rather than a cancellation.
+inline void applyTimeout(Response &response, const QString &reason) {
+    if (!reason.isEmpty()) {
+        response.error = QNetworkReply::TimeoutError;
+        response.errorString = reason;
+    }
+}
+
+// Reads what reply has buffered in chunks of chunkSize bytes and keeps the first maxErrorBodySize
+// bytes in body. An error body must still be read, or a full read buffer stalls the reply.
+inline void drainErrorBody(QNetworkReply *reply, qint64 chunkSize, QByteArray *body) {
+    while (reply->bytesAvailable() > 0) {
+        QByteArray chunk = reply->read(chunkSize);
+        body->append(chunk.left(maxErrorBodySize - body->size()));
+    }
+}
+
+#endif /* __REPLYUTIL_H__ */
@@ -0,0 +1,396 @@
+#include "httpclient/responsecache.h"
+
+#include <QCryptographicHash>
+#include <QLocale>
+#include <QTimeZone>
+
+#include "httpclient/diskcache.h"
+
+// Heuristic freshness is 10% of the time since Last-Modified, at most a day (RFC 9111 4.2.2).
+static constexpr qint64 maxHeuristicLifetime = 24 * 60 * 60;
+
+// Status codes that are cacheable by default (RFC 9110 15.1).
+static bool isHeuristicallyCacheable(int statusCode) {
+    switch (statusCode) {
+        case 200:
+        case 203:
+        case 204:
+        case 300:
+        case 301:
+        case 308:
+        case 404:
+        case 405:
+        case 410:
+        case 414:
+        case 501:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Returns true if the request asks to bypass stored responses.
+static bool bypassesCache(const QNetworkRequest &request) {
+    QHash<QByteArray, QByteArray> directives = ResponseCache::parseCacheControl(request.rawHeader("Cache-Control"));
+    return directives.contains("no-store") || directives.contains("no-cache") || directives.value("max-age") == "0";
+}
+
+qint64 CacheEntry::age(const QDateTime &now) const {
+    return initialAge + qMax<qint64>(responseTime.secsTo(now), 0);
+}
+
+bool CacheEntry::isFresh(const QDateTime &now) const {
+    return freshnessLifetime > age(now);
+}
+
+bool CacheEntry::isUsableWhileRevalidating(const QDateTime &now) const {
+    return freshnessLifetime + staleWhileRevalidate > age(now);
+}
+
+bool CacheEntry::isUsableOnError(const QDateTime &now) const {
+    return freshnessLifetime + staleIfError > age(now);
+}
+
+qint64 CacheEntry::cost() const {
+    qint64 cost = key.size() + credential.size() + response.body.size();
+    for (const QNetworkReply::RawHeaderPair &pair : response.rawHeaders) {
+        cost += pair.first.size() + pair.second.size();
+    }
+    return cost;
+}
+
+ResponseCache::ResponseCache(qint64 maxBytes) : budget(maxBytes) {}
+
+void ResponseCache::setMaxBytes(qint64 bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict();
+}
+
+qint64 ResponseCache::maxBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+qint64 ResponseCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+void ResponseCache::setShared(bool shared) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->shared = shared;
+}
+
+bool ResponseCache::isShared() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return shared;
+}
+
+void ResponseCache::setDiskCache(DiskCache *disk) {
+    this->disk.store(disk);
+}
+
+DiskCache *ResponseCache::diskCache() const {
+    return disk.load();
+}
+
+std::shared_ptr<const CacheEntry> ResponseCache::lookup(const QNetworkRequest &request) {
+    std::shared_ptr<const CacheEntry> entry;
+    if (!bypassesCache(request)) {
+        QByteArray key = keyOf(request.url());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(key);
+            if (it != index.end()) {
+                entry = **it;
+                entries.splice(entries.begin(), entries, *it);
+            }
+        }
+
+        // Promote responses of the persistent tier, their bodies stay mapped from disk.
+        DiskCache *persistent = disk.load();
+        if (!entry && persistent) {
+            entry = persistent->load(key);
+            if (entry) {
+                std::lock_guard<std::mutex> lock(mutex);
+                insert(entry);
+            }
+        }
+    }
+
+    // A stored response is only valid for requests sending the same credential and varying headers.
+    if (entry && entry->credential != credentialOf(request)) {
+        entry.reset();
+    }
+    if (entry) {
+        for (const auto &header : entry->varyHeaders) {
+            if (request.rawHeader(header.first) != header.second) {
+                entry.reset();
+                break;
+            }
+        }
+    }
+
+    if (entry && entry->isUsableWhileRevalidating(QDateTime::currentDateTimeUtc())) {
+        hitCount++;
+    } else {
+        missCount++;
+    }
+    return entry;
+}
+
+bool ResponseCache::store(const QNetworkRequest &request, const Response &response, const QDateTime &requestTime) {
+    std::shared_ptr<CacheEntry> entry = makeEntry(request, response, requestTime);
+
+    DiskCache *persistent = disk.load();
+    if (persistent) {
+        if (entry) {
+            persistent->save(*entry);
+        } else {
+            persistent->remove(keyOf(request.url()));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(keyOf(request.url()));
+    if (it != index.end()) {
+        erase(*it);
+    }
+    if (!entry) {
+        return false;
+    }
+    insert(entry);
+    return true;
+}
+
+Response ResponseCache::freshen(const QNetworkRequest &request, const CacheEntry &stale, const Response &notModified,
+                               const QDateTime &requestTime) {
+    Response response = stale.response;
+    response.timing = notModified.timing;
+    response.attempts = notModified.attempts;
+    response.retries = notModified.retries;
+    response.hedged = notModified.hedged;
+
+    for (const QNetworkReply::RawHeaderPair &header : notModified.rawHeaders) {
+        if (header.first.compare("Content-Length", Qt::CaseInsensitive) == 0) {
+            continue;
+        }
+
+        bool replaced = false;
+        for (QNetworkReply::RawHeaderPair &stored : response.rawHeaders) {
+            if (stored.first.compare(header.first, Qt::CaseInsensitive) == 0) {
+                stored.second = header.second;
+                replaced = true;
+            }
+        }
+        if (!replaced) {
+            response.rawHeaders.append(header);
+        }
+    }
+
+    revalidationCount++;
+    store(request, response, requestTime);
+    return response;
+}
+
+bool ResponseCache::addValidators(QNetworkRequest *request, const CacheEntry &entry) {
+    QByteArray etag = entry.response.header("ETag");
+    QByteArray lastModified = entry.response.header("Last-Modified");
+    if (!etag.isEmpty()) {
+        request->setRawHeader("If-None-Match", etag);
+    }
+    if (!lastModified.isEmpty()) {
+        request->setRawHeader("If-Modified-Since", lastModified);
+    }
+    return !etag.isEmpty() || !lastModified.isEmpty();
+}
+
+void ResponseCache::invalidate(const QUrl &url) {
+    DiskCache *persistent = disk.load();
+    if (persistent) {
+        persistent->remove(keyOf(url));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(keyOf(url));
+    if (it != index.end()) {
+        erase(*it);
+    }
+}
+
+void ResponseCache::clear() {
+    DiskCache *persistent = disk.load();
+    if (persistent) {
+        persistent->clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+qint64 ResponseCache::hits() const {
+    return hitCount.load();
+}
+
+qint64 ResponseCache::misses() const {
+    return missCount.load();
+}
+
+qint64 ResponseCache::revalidations() const {
+    return revalidationCount.load();
+}
+
+QHash<QByteArray, QByteArray> ResponseCache::parseCacheControl(const QByteArray &value) {
+    QHash<QByteArray, QByteArray> directives;
+    for (const QByteArray &part : value.split(',')) {
+        QByteArray directive = part.trimmed();
+        if (directive.isEmpty()) {
+            continue;
+        }
+
+        qsizetype equals = directive.indexOf('=');
+        if (equals < 0) {
+            directives.insert(directive.toLower(), QByteArray());
+            continue;
+        }
+
+        QByteArray argument = directive.mid(equals + 1).trimmed();
+        if (argument.size() >= 2 && argument.startsWith("\"") && argument.endsWith("\"")) {
+            argument = argument.mid(1, argument.size() - 2);
+        }
+        directives.insert(directive.left(equals).trimmed().toLower(), argument);
+    }
+    return directives;
+}
+
+QDateTime ResponseCache::parseHttpDate(const QByteArray &value) {
+    QDateTime date = QLocale::c().toDateTime(QString::fromLatin1(value.trimmed()), "ddd, dd MMM yyyy HH:mm:ss 'GMT'");
+    date.setTimeZone(QTimeZone::utc());
+    return date;
+}
+
+std::shared_ptr<CacheEntry> ResponseCache::makeEntry(const QNetworkRequest &request, const Response &response,
+                                                     const QDateTime &requestTime) const {
+    QHash<QByteArray, QByteArray> requestDirectives = parseCacheControl(request.rawHeader("Cache-Control"));
+    QHash<QByteArray, QByteArray> directives = parseCacheControl(response.header("Cache-Control"));
+    if (response.statusCode < 200 || requestDirectives.contains("no-store") || directives.contains("no-store")) {
+        return nullptr;
+    }
+
+    bool sharedCache = isShared();
+    if (sharedCache && directives.contains("private")) {
+        return nullptr;
+    }
+    if (sharedCache && request.hasRawHeader("Authorization") && !directives.contains("public") &&
+        !directives.contains("s-maxage") && !directives.contains("must-revalidate")) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<CacheEntry>();
+    entry->key = keyOf(request.url());
+    entry->credential = credentialOf(request);
+    entry->response = response;
+    entry->responseTime = QDateTime::currentDateTimeUtc();
+
+    for (const QByteArray &name : response.header("Vary").split(',')) {
+        QByteArray header = name.trimmed().toLower();
+        if (header == "*") {
+            return nullptr;
+        }
+        // The credential already selects the response, and must not be kept in clear.
+        if (!header.isEmpty() && header != "authorization") {
+            entry->varyHeaders.append(qMakePair(header, request.rawHeader(header)));
+        }
+    }
+
+    // Corrected initial age (RFC 9111 4.2.3).
+    QDateTime date = parseHttpDate(response.header("Date"));
+    if (!date.isValid()) {
+        date = entry->responseTime;
+    }
+    qint64 apparentAge = qMax<qint64>(date.secsTo(entry->responseTime), 0);
+    qint64 responseDelay = qMax<qint64>(requestTime.secsTo(entry->responseTime), 0);
+    entry->initialAge = qMax(apparentAge, qMax<qint64>(response.header("Age").toLongLong(), 0) + responseDelay);
+
+    // Freshness lifetime (RFC 9111 4.2.1), no-cache responses must always be revalidated.
+    bool explicitLifetime = true;
+    if (directives.contains("no-cache")) {
+        entry->freshnessLifetime = 0;
+    } else if (sharedCache && directives.contains("s-maxage")) {
+        entry->freshnessLifetime = directives.value("s-maxage").toLongLong();
+    } else if (directives.contains("max-age")) {
+        entry->freshnessLifetime = directives.value("max-age").toLongLong();
+    } else if (response.hasHeader("Expires")) {
+        // An invalid Expires, such as "0", means already expired.
+        QDateTime expires = parseHttpDate(response.header("Expires"));
+        entry->freshnessLifetime = expires.isValid() ? qMax<qint64>(date.secsTo(expires), 0) : 0;
+    } else {
+        explicitLifetime = false;
+        QDateTime lastModified = parseHttpDate(response.header("Last-Modified"));
+        if (lastModified.isValid()) {
+            entry->freshnessLifetime = qMin(qMax<qint64>(lastModified.secsTo(date), 0) / 10, maxHeuristicLifetime);
+        }
+    }
+
+    if (!explicitLifetime && !isHeuristicallyCacheable(response.statusCode)) {
+        return nullptr;
+    }
+
+    // Windows past the freshness lifetime in which the response may still be served (RFC 5861),
+    // unless it must not be served stale without validation (RFC 9111 5.2.2.2, 5.2.2.4, 5.2.2.8).
+    bool mustRevalidate = directives.contains("no-cache") || directives.contains("must-revalidate") ||
+                          (sharedCache && directives.contains("proxy-revalidate"));
+    if (!mustRevalidate) {
+        entry->staleWhileRevalidate = qMax<qint64>(directives.value("stale-while-revalidate").toLongLong(), 0);
+        entry->staleIfError = qMax<qint64>(directives.value("stale-if-error").toLongLong(), 0);
+    }
+
+    // A response that is never fresh is only worth keeping if it can be revalidated or served stale.
+    if (entry->freshnessLifetime <= 0 && entry->staleWhileRevalidate <= 0 && entry->staleIfError <= 0 &&
+        !response.hasHeader("ETag") && !response.hasHeader("Last-Modified")) {
+        return nullptr;
+    }
+    return entry;
+}
+
+void ResponseCache::insert(std::shared_ptr<const CacheEntry> entry) {
+    auto it = index.find(entry->key);
+    if (it != index.end()) {
+        erase(*it);
+    }
+
+    // Too large for memory, the persistent tier may still hold it.
+    if (entry->cost() > budget) {
+        return;
+    }
+    bytes += entry->cost();
+    entries.push_front(std::move(entry));
+    index.insert(entries.front()->key, entries.begin());
+    evict();
+}
+
+void ResponseCache::erase(Entries::iterator it) {
+    bytes -= (*it)->cost();
+    index.remove((*it)->key);
+    entries.erase(it);
+}
+
+void ResponseCache::evict() {
+    while (bytes > budget && !entries.empty()) {
+        erase(std::prev(entries.end()));
+    }
+}
+
+QByteArray ResponseCache::keyOf(const QUrl &url) {
+    return url.adjusted(QUrl::RemoveFragment).toEncoded();
+}
+
+QByteArray ResponseCache::credentialOf(const QNetworkRequest &request) {
+    if (!request.hasRawHeader("Authorization")) {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(request.rawHeader("Authorization"), QCryptographicHash::Sha256).toHex();
+}
@@ -0,0 +1,90 @@
+#include "httpclient/retrypolicy.h"
+
+#include <QDateTime>
+#include <QRandomGenerator>
+
+// Network errors after which sending the request again may succeed.
+static bool isTransientError(QNetworkReply::NetworkError error) {
+    switch (error) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyConnectionClosedError:
+        case QNetworkReply::ProxyTimeoutError:
+        case QNetworkReply::UnknownNetworkError:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Network errors raised before any byte of the request reached the server.
+static bool isUnsentError(QNetworkReply::NetworkError error) {
+    return error == QNetworkReply::ConnectionRefusedError || error == QNetworkReply::HostNotFoundError;
+}
+
+bool RetryPolicy::isTransient(const Response &response) const {
+    if (response.statusCode != 0) {
+        return retryableStatusCodes.contains(response.statusCode);
+    }
+    return isTransientError(response.error);
+}
+
+bool RetryPolicy::canRetry(const QByteArray &method, const QNetworkRequest &request, const Response &response) const {
+    if (!isTransient(response)) {
+        return false;
+    }
+    if (response.statusCode == 0 && isUnsentError(response.error)) {
+        return true;
+    }
+    return idempotentMethods.contains(method.toUpper()) || request.hasRawHeader("Idempotency-Key");
+}
+
+std::chrono::milliseconds RetryPolicy::backoff(int retry, const Response &response) const {
+    std::chrono::milliseconds after = retryAfter(response);
+    if (after.count() >= 0) {
+        return after <= maxDelay ? after : std::chrono::milliseconds(-1);
+    }
+
+    // Doubling stops at maxDelay, the shift is bounded to keep it from overflowing.
+    qint64 ceiling = baseDelay.count() << qMin(qMax(retry - 1, 0), 30);
+    if (ceiling <= 0 || ceiling > maxDelay.count()) {
+        ceiling = maxDelay.count();
+    }
+    return std::chrono::milliseconds(QRandomGenerator::global()->bounded(ceiling + 1));
+}
+
+std::chrono::milliseconds RetryPolicy::retryAfter(const Response &response) {
+    QByteArray value = response.header("Retry-After").trimmed();
+    if (value.isEmpty()) {
+        return std::chrono::milliseconds(-1);
+    }
+
+    bool isNumber = false;
+    qint64 seconds = value.toLongLong(&isNumber);
+    if (isNumber) {
+        return std::chrono::milliseconds(seconds >= 0 ? seconds * 1000 : -1);
+    }
+
+    QDateTime date = QDateTime::fromString(QString::fromLatin1(value), Qt::RFC2822Date);
+    if (!date.isValid()) {
+        return std::chrono::milliseconds(-1);
+    }
+    return std::chrono::milliseconds(qMax<qint64>(QDateTime::currentDateTimeUtc().msecsTo(date), 0));
+}
+
+RetryBudget::RetryBudget(double capacity, double refill) : capacity(capacity), refill(refill), tokens(capacity) {}
+
+bool RetryBudget::recordFailure() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tokens = qMax(tokens - 1, 0.0);
+    return tokens > capacity / 2;
+}
+
+void RetryBudget::recordSuccess() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tokens = qMin(tokens + refill, capacity);
+}
@@ -0,0 +1,205 @@
+#include "httpclient/segmenteddownloader.h"
+
+#include <QDebug>
+#include <QSaveFile>
+
+#include "replyutil.h"
+
+// State shared by the HEAD request and all segment requests of one download.
+struct SegmentedDownloader::Transfer {
+    QString url;
+    QString path;
+    ResponseCallback onFinished;
+    std::unique_ptr<QSaveFile> file;
+    QList<QNetworkReply *> replies;  // segment requests still running
+    int pending = 0;                 // segments not yet completed
+    bool done = false;               // the result has been reported
+};
+
+SegmentedDownloader::SegmentedDownloader(HttpClient *client, QObject *parent) : QObject(parent), client(client) {}
+
+void SegmentedDownloader::setConnections(int connections) {
+    if (connections > maxHttp1Connections) {
+        qWarning() << "QNetworkAccessManager opens at most" << maxHttp1Connections
+                   << "connections per host, using" << maxHttp1Connections << "instead of" << connections;
+    }
+    maxConnections = qBound(1, connections, maxHttp1Connections);
+}
+
+int SegmentedDownloader::connections() const {
+    return maxConnections;
+}
+
+void SegmentedDownloader::setMinimumSegmentSize(qint64 bytes) {
+    minSegmentSize = bytes;
+}
+
+qint64 SegmentedDownloader::minimumSegmentSize() const {
+    return minSegmentSize;
+}
+
+void SegmentedDownloader::download(const QString &url, const QString &path, ResponseCallback onFinished) noexcept {
+    auto transfer = std::make_shared<Transfer>();
+    transfer->url = url;
+    transfer->path = path;
+    transfer->onFinished = std::move(onFinished);
+
+    // The reply is the context object so the download also runs on the network thread of
+    // download_sync, whose caller is blocked.
+    QNetworkReply *reply = client->sendRequest("HEAD", url);
+    auto timeout = client->watchClientTimeouts(reply);
+    connect(reply, &QNetworkReply::finished, reply, [this, reply, transfer, timeout]() {
+        Response response = HttpClient::readResponse(reply);
+        applyTimeout(response, *timeout);
+        qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        bool acceptsRanges = reply->rawHeader("Accept-Ranges").toLower().contains("bytes");
+
+        // If-Range only accepts strong validators.
+        QByteArray validator = reply->rawHeader("ETag");
+        if (validator.isEmpty() || validator.startsWith("W/")) {
+            validator = reply->rawHeader("Last-Modified");
+        }
+        reply->deleteLater();
+
+        if (!response.ok() || !acceptsRanges || maxConnections < 2 || length < 2 * minSegmentSize) {
+            client->download(transfer->url, transfer->path, transfer->onFinished);
+            return;
+        }
+        startSegments(transfer, length, validator);
+    });
+}
+
+void SegmentedDownloader::download_sync(const QString &url, const QString &path) {
+    Response response = client->execute(
+        [this, url, path](ResponseCallback done) { download(url, path, std::move(done)); });
+
+    if (!response.ok()) {
+        throw NetworkException(response);
+    }
+}
+
+void SegmentedDownloader::startSegments(std::shared_ptr<Transfer> transfer, qint64 length, const QByteArray &validator) {
+    transfer->file = std::make_unique<QSaveFile>(transfer->path);
+    if (!transfer->file->open(QIODevice::WriteOnly) || !transfer->file->resize(length)) {
+        Response response;
+        response.error = QNetworkReply::UnknownContentError;
+        response.errorString = transfer->file->errorString();
+        fail(transfer, response);
+        return;
+    }
+
+    const qint64 count = qMin<qint64>(maxConnections, length / minSegmentSize);
+    const qint64 segmentSize = (length + count - 1) / count;
+    const qint64 chunkSize = client->streamBufferSize();
+
+    for (qint64 start = 0; start < length; start += segmentSize) {
+        const qint64 end = qMin(start + segmentSize, length) - 1;
+
+        // Each segment needs a connection of its own, HTTP/2 would multiplex them over one.
+        QNetworkRequest request = client->createRequest(transfer->url);
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(start) + "-" + QByteArray::number(end));
+        if (!validator.isEmpty()) {
+            request.setRawHeader("If-Range", validator);
+        }
+
+        QNetworkReply *reply = client->sendRequest("GET", request);
+        reply->setReadBufferSize(chunkSize);
+        transfer->replies.append(reply);
+        transfer->pending++;
+        auto timeout = client->watchClientTimeouts(reply);
+
+        // The server ignored the range, most likely because the resource changed since the
+        // HEAD request. Start over with a single stream rather than receive the whole body.
+        connect(reply, &QNetworkReply::metaDataChanged, reply, [this, reply, transfer]() {
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (transfer->done || statusCode != 200) {
+                return;
+            }
+            transfer->done = true;
+            for (QNetworkReply *segment : QList<QNetworkReply *>(transfer->replies)) {
+                segment->abort();
+            }
+            transfer->file->cancelWriting();
+            client->download(transfer->url, transfer->path, transfer->onFinished);
+        });
+
+        // Writes the buffered part of this segment at its offset in the file. Other bodies are
+        // read as well, or a full buffer would stop Qt from reading the socket.
+        auto offset = std::make_shared<qint64>(start);
+        auto errorBody = std::make_shared<QByteArray>();
+        auto drain = [reply, transfer, offset, end, chunkSize, errorBody]() {
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (transfer->done || statusCode != 206) {
+                drainErrorBody(reply, chunkSize, errorBody.get());
+                return;
+            }
+
+            while (reply->bytesAvailable() > 0 && *offset <= end) {
+                QByteArray chunk = reply->read(qMin(chunkSize, end + 1 - *offset));
+                if (!transfer->file->seek(*offset) || transfer->file->write(chunk) != chunk.size()) {
+                    Response response;
+                    response.error = QNetworkReply::UnknownContentError;
+                    response.errorString = transfer->file->errorString();
+                    fail(transfer, response);
+                    return;
+                }
+                *offset += chunk.size();
+            }
+        };
+
+        connect(reply, &QNetworkReply::readyRead, reply, drain);
+        connect(reply, &QNetworkReply::finished, reply, [reply, transfer, offset, end, drain, errorBody, timeout]() {
+            drain();
+            Response response = HttpClient::readResponse(reply);
+            response.body = *errorBody;
+            applyTimeout(response, *timeout);
+            transfer->replies.removeOne(reply);
+            reply->deleteLater();
+
+            if (transfer->done) {
+                return;
+            }
+
+            if (!response.ok()) {
+                fail(transfer, response);
+                return;
+            }
+
+            if (response.statusCode != 206 || *offset != end + 1) {
+                response.error = QNetworkReply::ProtocolFailure;
+                response.errorString = "Incomplete segment received";
+                fail(transfer, response);
+                return;
+            }
+
+            if (--transfer->pending > 0) {
+                return;
+            }
+
+            transfer->done = true;
+            response.body.clear();
+            if (!transfer->file->commit()) {
+                response.error = QNetworkReply::UnknownContentError;
+                response.errorString = transfer->file->errorString();
+            }
+            if (transfer->onFinished) {
+                transfer->onFinished(response);
+            }
+        });
+    }
+}
+
+void SegmentedDownloader::fail(const std::shared_ptr<Transfer> &transfer, const Response &response) {
+    transfer->done = true;
+
+    // Aborting emits finished, which removes the reply from the list.
+    for (QNetworkReply *reply : QList<QNetworkReply *>(transfer->replies)) {
+        reply->abort();
+    }
+    transfer->file->cancelWriting();
+
+    if (transfer->onFinished) {
+        transfer->onFinished(response);
+    }
+}
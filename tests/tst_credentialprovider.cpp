@@ -0,0 +1,49 @@
+#include <QtTest>
+
+#include "httpclient/credentialprovider.h"
+
+// Builds an unsigned JWT carrying payload.
+static QString jwt(const QByteArray &payload) {
+    QByteArray::Base64Options options = QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals;
+    return QString::fromLatin1(QByteArray(R"({"alg":"none"})").toBase64(options) + "." + payload.toBase64(options) +
+                               ".signature");
+}
+
+class TestCredentialProvider : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void jwtExpiryReadsExp() {
+        QDateTime expiry = CredentialProvider::jwtExpiry(jwt(R"({"sub":"user","exp":1900000000})"));
+        QCOMPARE(expiry, QDateTime::fromSecsSinceEpoch(1900000000, QTimeZone::utc()));
+    }
+
+    void jwtExpiryTruncatesFractionalSeconds() {
+        QDateTime expiry = CredentialProvider::jwtExpiry(jwt(R"({"exp":1900000000.75})"));
+        QCOMPARE(expiry, QDateTime::fromSecsSinceEpoch(1900000000, QTimeZone::utc()));
+    }
+
+    void jwtExpiryDecodesBase64Url() {
+        // "~~~" encodes to characters that differ between base64 and base64url.
+        QDateTime expiry = CredentialProvider::jwtExpiry(jwt(R"({"name":"~~~???","exp":1900000000})"));
+        QCOMPARE(expiry, QDateTime::fromSecsSinceEpoch(1900000000, QTimeZone::utc()));
+    }
+
+    void jwtExpiryRejectsTokensWithoutExp_data() {
+        QTest::addColumn<QString>("token");
+        QTest::newRow("opaque token") << QString("0123456789abcdef");
+        QTest::newRow("two parts") << QString("eyJhbGciOiJub25lIn0.eyJleHAiOjE5MDAwMDAwMDB9");
+        QTest::newRow("no exp claim") << jwt(R"({"sub":"user"})");
+        QTest::newRow("exp as string") << jwt(R"({"exp":"1900000000"})");
+        QTest::newRow("payload not json") << jwt("not json");
+        QTest::newRow("empty") << QString();
+    }
+
+    void jwtExpiryRejectsTokensWithoutExp() {
+        QFETCH(QString, token);
+        QVERIFY(!CredentialProvider::jwtExpiry(token).isValid());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCredentialProvider)
+#include "tst_credentialprovider.moc"
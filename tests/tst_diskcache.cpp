@@ -0,0 +1,143 @@
+#include <QtTest>
+
+#include "httpclient/diskcache.h"
+
+static CacheEntry makeEntry(const QByteArray &key, const QByteArray &body, const QByteArray &etag = "\"v1\"") {
+    CacheEntry entry;
+    entry.key = key;
+    entry.response.statusCode = 200;
+    entry.response.reasonPhrase = "OK";
+    entry.response.body = body;
+    entry.response.rawHeaders.append(qMakePair(QByteArray("ETag"), etag));
+    entry.responseTime = QDateTime::fromSecsSinceEpoch(QDateTime::currentSecsSinceEpoch(), QTimeZone::utc());
+    entry.freshnessLifetime = 60;
+    return entry;
+}
+
+// Path of the file holding body in the cache at directory.
+static QString bodyPath(const QTemporaryDir &directory, const QByteArray &body) {
+    return directory.filePath(QString::fromLatin1(QCryptographicHash::hash(body, QCryptographicHash::Sha256).toHex()));
+}
+
+class TestDiskCache : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void entriesSurviveReopening() {
+        QTemporaryDir directory;
+        QByteArray body(100000, 'a');
+        {
+            DiskCache cache(directory.path());
+            QVERIFY(cache.save(makeEntry("https://mysite.com/a", body)));
+        }
+
+        DiskCache cache(directory.path());
+        QCOMPARE(cache.size(), qint64(body.size()));
+        std::shared_ptr<CacheEntry> entry = cache.load("https://mysite.com/a");
+        QVERIFY(entry);
+        QCOMPARE(entry->response.body, body);
+        QCOMPARE(entry->response.statusCode, 200);
+        QCOMPARE(entry->response.header("ETag"), QByteArray("\"v1\""));
+        QCOMPARE(entry->freshnessLifetime, qint64(60));
+        QVERIFY(!cache.load("https://mysite.com/b"));
+    }
+
+    void identicalBodiesAreStoredOnce() {
+        QTemporaryDir directory;
+        DiskCache cache(directory.path());
+        QByteArray body(1000, 'b');
+        QVERIFY(cache.save(makeEntry("https://mysite.com/a", body)));
+        QVERIFY(cache.save(makeEntry("https://mysite.com/b", body)));
+        QCOMPARE(cache.size(), qint64(body.size()));
+
+        // The body stays while another entry refers to it.
+        cache.remove("https://mysite.com/a");
+        QVERIFY(QFile::exists(bodyPath(directory, body)));
+        cache.remove("https://mysite.com/b");
+        QVERIFY(!QFile::exists(bodyPath(directory, body)));
+        QCOMPARE(cache.size(), qint64(0));
+    }
+
+    void orphanBodiesAreRemovedOnOpen() {
+        QTemporaryDir directory;
+        QByteArray orphan = "written before a crash";
+        writeFile(bodyPath(directory, orphan), orphan);
+        writeFile(directory.filePath("notes.txt"), "not a body");
+
+        DiskCache cache(directory.path());
+        QVERIFY(!QFile::exists(bodyPath(directory, orphan)));
+        QVERIFY(QFile::exists(directory.filePath("notes.txt")));
+    }
+
+    void entriesWithDamagedBodiesAreDroppedOnOpen() {
+        QTemporaryDir directory;
+        QByteArray body(1000, 'c');
+        {
+            DiskCache cache(directory.path());
+            QVERIFY(cache.save(makeEntry("https://mysite.com/a", body)));
+        }
+        writeFile(bodyPath(directory, body), body.left(10));
+
+        DiskCache cache(directory.path());
+        QVERIFY(!cache.load("https://mysite.com/a"));
+        QCOMPARE(cache.size(), qint64(0));
+        QVERIFY(!QFile::exists(bodyPath(directory, body)));
+    }
+
+    void unchangedBodiesAreNotRewritten() {
+        QTemporaryDir directory;
+        QByteArray body(1000, 'd');
+        {
+            DiskCache cache(directory.path());
+            QVERIFY(cache.save(makeEntry("https://mysite.com/a", body, "\"v1\"")));
+
+            QFile file(bodyPath(directory, body));
+            QVERIFY(file.open(QIODevice::ReadWrite));
+            QDateTime past = QDateTime::currentDateTimeUtc().addDays(-1);
+            QVERIFY(file.setFileTime(past, QFileDevice::FileModificationTime));
+            file.close();
+
+            // Freshening after a 304 Not Modified stores the same body with new headers.
+            QVERIFY(cache.save(makeEntry("https://mysite.com/a", body, "\"v2\"")));
+            QVERIFY(QFileInfo(file.fileName()).lastModified() < QDateTime::currentDateTimeUtc().addSecs(-3600));
+        }
+
+        DiskCache cache(directory.path());
+        std::shared_ptr<CacheEntry> entry = cache.load("https://mysite.com/a");
+        QVERIFY(entry);
+        QCOMPARE(entry->response.header("ETag"), QByteArray("\"v2\""));
+        QCOMPARE(entry->response.body, body);
+    }
+
+    void responsesOutliveTheCache() {
+        QTemporaryDir directory;
+        QByteArray body(100000, 'e');
+        Response response;
+        {
+            DiskCache cache(directory.path());
+            QVERIFY(cache.save(makeEntry("https://mysite.com/a", body)));
+            response = cache.load("https://mysite.com/a")->response;
+            QVERIFY(response.bodyStorage);
+        }
+        QCOMPARE(response.body, body);
+    }
+
+    void evictsLeastRecentlyUsedEntries() {
+        QTemporaryDir directory;
+        DiskCache cache(directory.path(), 2500);
+        QVERIFY(cache.save(makeEntry("https://mysite.com/a", QByteArray(1000, '1'))));
+        QVERIFY(cache.save(makeEntry("https://mysite.com/b", QByteArray(1000, '2'))));
+        QTest::qWait(5);
+        QVERIFY(cache.load("https://mysite.com/a"));
+        QTest::qWait(5);
+        QVERIFY(cache.save(makeEntry("https://mysite.com/c", QByteArray(1000, '3'))));
+
+        QVERIFY(cache.load("https://mysite.com/a"));
+        QVERIFY(!cache.load("https://mysite.com/b"));
+        QVERIFY(cache.load("https://mysite.com/c"));
+        QCOMPARE(cache.size(), qint64(2000));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDiskCache)
+#include "tst_diskcache.moc"
@@ -0,0 +1,101 @@
+#include <QtTest>
+
+#include "httpclient/hedgepolicy.h"
+
+using std::chrono::milliseconds;
+
+class TestHedgePolicy : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void delayWaitsForMinSamples() {
+        HedgePolicy policy;
+        policy.minSamples = 5;
+        HedgeTracker tracker(policy);
+
+        for (int i = 0; i < 4; i++) {
+            tracker.recordLatency(milliseconds(100));
+            QVERIFY(tracker.delay() < milliseconds(0));
+        }
+        tracker.recordLatency(milliseconds(100));
+        QCOMPARE(tracker.delay(), milliseconds(100));
+    }
+
+    void delayIsThePercentile() {
+        HedgePolicy policy;
+        policy.percentile = 0.95;
+        policy.minDelay = milliseconds(0);
+        HedgeTracker tracker(policy);
+
+        // Recorded out of order: 1 to 100 ms.
+        for (int i = 0; i < 100; i++) {
+            tracker.recordLatency(milliseconds((i * 37) % 100 + 1));
+        }
+        QCOMPARE(tracker.delay(), milliseconds(96));
+    }
+
+    void delayIsAtLeastMinDelay() {
+        HedgePolicy policy;
+        policy.minSamples = 1;
+        policy.minDelay = milliseconds(25);
+        HedgeTracker tracker(policy);
+
+        tracker.recordLatency(milliseconds(2));
+        QCOMPARE(tracker.delay(), milliseconds(25));
+    }
+
+    void delayOnlyUsesTheWindow() {
+        HedgePolicy policy;
+        policy.minSamples = 10;
+        policy.window = 10;
+        policy.minDelay = milliseconds(0);
+        HedgeTracker tracker(policy);
+
+        for (int i = 0; i < 100; i++) {
+            tracker.recordLatency(milliseconds(1000));
+        }
+        for (int i = 0; i < 10; i++) {
+            tracker.recordLatency(milliseconds(5));
+        }
+        QCOMPARE(tracker.delay(), milliseconds(5));
+    }
+
+    void hedgesAreCappedByTheRatio() {
+        HedgePolicy policy;
+        policy.maxHedgeRatio = 0.25;
+        HedgeTracker tracker(policy);
+
+        QVERIFY(!tracker.tryHedge());
+        for (int i = 0; i < 4; i++) {
+            tracker.recordRequest();
+        }
+        QVERIFY(tracker.tryHedge());
+        QVERIFY(!tracker.tryHedge());
+    }
+
+    void hedgeBudgetIsBounded() {
+        HedgePolicy policy;
+        policy.maxHedgeRatio = 1;
+        HedgeTracker tracker(policy);
+
+        for (int i = 0; i < 100; i++) {
+            tracker.recordRequest();
+        }
+        int hedges = 0;
+        while (tracker.tryHedge()) {
+            hedges++;
+        }
+        QCOMPARE(hedges, 10);
+    }
+
+    void zeroRatioDisablesHedging() {
+        HedgeTracker tracker{HedgePolicy()};
+        for (int i = 0; i < 100; i++) {
+            tracker.recordRequest();
+        }
+        QVERIFY(!tracker.tryHedge());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestHedgePolicy)
+#include "tst_hedgepolicy.moc"
@@ -0,0 +1,214 @@
+#include <QtTest>
+
+#include "httpclient/credentialprovider.h"
+#include "httpclient/httpclient.h"
+#include "httpclient/responsecache.h"
+#include "localserver.h"
+
+using Reply = LocalServer::Reply;
+using Request = LocalServer::Request;
+
+// Responses delivered to the callbacks made by collect.
+struct Responses {
+    QList<Response> received;
+
+    ResponseCallback collect() {
+        return [this](const Response &response) { received.append(response); };
+    }
+};
+
+static QByteArray readAll(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+class TestHttpClient : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void unauthorizedRequestsShareOneRefresh() {
+        LocalServer server;
+        server.handle("/private", [](const Request &request) {
+            Reply reply;
+            reply.statusCode = request.header("Authorization") == "Bearer fresh" ? 200 : 401;
+            reply.body = reply.statusCode == 200 ? "secret" : "";
+            return reply;
+        });
+
+        int refreshes = 0;
+        CredentialProvider credentials("expired");
+        credentials.setRefreshFunction([&refreshes](std::function<void(const QString &token)> done) {
+            refreshes++;
+            done("fresh");
+        });
+
+        HttpClient client;
+        client.setCredentialProvider(&credentials);
+        Responses responses;
+        for (int i = 0; i < 3; i++) {
+            client.get(server.url("/private"), responses.collect());
+        }
+
+        QTRY_COMPARE(responses.received.size(), 3);
+        for (const Response &response : responses.received) {
+            QCOMPARE(response.statusCode, 200);
+            QCOMPARE(response.body, QByteArray("secret"));
+        }
+        QCOMPARE(refreshes, 1);
+        QCOMPARE(server.requests("/private"), qint64(6));
+    }
+
+    void identicalRequestsAreCoalesced() {
+        LocalServer server;
+        HttpClient client;
+        client.setCoalescing(true);
+
+        Responses responses;
+        for (int i = 0; i < 3; i++) {
+            client.get(server.url("/items"), responses.collect());
+        }
+
+        QTRY_COMPARE(responses.received.size(), 3);
+        int coalesced = 0;
+        for (const Response &response : responses.received) {
+            QVERIFY(response.ok());
+            QCOMPARE(response.body, QByteArray("{\"ok\":true}"));
+            coalesced += response.coalesced ? 1 : 0;
+        }
+        QCOMPARE(coalesced, 2);
+        QCOMPARE(server.requests("/items"), qint64(1));
+    }
+
+    void notModifiedFreshensTheStoredResponse() {
+        LocalServer server;
+        server.handle("/report", [](const Request &request) {
+            Reply reply;
+            reply.headers = {{"Cache-Control", "no-cache"}, {"ETag", "\"v1\""}};
+            if (request.header("If-None-Match") == "\"v1\"") {
+                reply.statusCode = 304;
+                reply.headers.append(qMakePair(QByteArray("X-Checked"), QByteArray("again")));
+                return reply;
+            }
+            reply.headers.append(qMakePair(QByteArray("X-Checked"), QByteArray("once")));
+            reply.body = "large report";
+            return reply;
+        });
+
+        ResponseCache cache;
+        HttpClient client;
+        client.setCache(&cache);
+        Responses responses;
+
+        client.get(server.url("/report"), responses.collect());
+        QTRY_COMPARE(responses.received.size(), 1);
+        QVERIFY(!responses.received[0].revalidated);
+
+        client.get(server.url("/report"), responses.collect());
+        QTRY_COMPARE(responses.received.size(), 2);
+        const Response &revalidated = responses.received[1];
+        QVERIFY(revalidated.ok());
+        QVERIFY(revalidated.revalidated);
+        QCOMPARE(revalidated.statusCode, 200);
+        QCOMPARE(revalidated.body, QByteArray("large report"));
+        QCOMPARE(revalidated.header("X-Checked"), QByteArray("again"));
+        QCOMPARE(cache.revalidations(), qint64(1));
+        QCOMPARE(server.requests("/report"), qint64(2));
+    }
+
+    void staleResponsesAreRefreshedInTheBackground() {
+        LocalServer server;
+        auto versions = std::make_shared<std::atomic<int>>(0);
+        server.handle("/feed", [versions](const Request &) {
+            Reply reply;
+            reply.headers = {{"Cache-Control", "max-age=1, stale-while-revalidate=60"}};
+            reply.body = "v" + QByteArray::number(++*versions);
+            return reply;
+        });
+
+        ResponseCache cache;
+        HttpClient client;
+        client.setCache(&cache);
+        Responses responses;
+
+        client.get(server.url("/feed"), responses.collect());
+        QTRY_COMPARE(responses.received.size(), 1);
+        QCOMPARE(responses.received[0].body, QByteArray("v1"));
+        QTest::qWait(2100);
+
+        // Served stale at once, refreshed by a single request behind it.
+        client.get(server.url("/feed"), responses.collect());
+        client.get(server.url("/feed"), responses.collect());
+        QTRY_COMPARE(responses.received.size(), 3);
+        QVERIFY(responses.received[1].stale);
+        QCOMPARE(responses.received[1].body, QByteArray("v1"));
+        QCOMPARE(responses.received[2].body, QByteArray("v1"));
+        QTRY_COMPARE(server.requests("/feed"), qint64(2));
+
+        QTRY_VERIFY(cache.lookup(QNetworkRequest(QUrl(server.url("/feed"))))->response.body == "v2");
+        client.get(server.url("/feed"), responses.collect());
+        QTRY_COMPARE(responses.received.size(), 4);
+        QVERIFY(!responses.received[3].stale);
+        QCOMPARE(responses.received[3].body, QByteArray("v2"));
+        QCOMPARE(server.requests("/feed"), qint64(2));
+    }
+
+    void interruptedDownloadsResumeWithIfRange() {
+        LocalServer server(256 * 1024);
+        const QByteArray blob = server.blob();
+        auto resumedAt = std::make_shared<std::atomic<qint64>>(-1);
+        server.handle("/artifact", [blob, resumedAt](const Request &request) {
+            Reply reply;
+            reply.headers = {{"ETag", "\"blob\""}, {"Accept-Ranges", "bytes"}};
+            QByteArray range = request.header("Range");
+            if (!range.startsWith("bytes=") || request.header("If-Range") != "\"blob\"") {
+                // The connection drops halfway through the first transfer.
+                reply.body = blob;
+                reply.cutAfter = blob.size() / 2;
+                return reply;
+            }
+
+            qint64 first = range.mid(6, range.indexOf('-') - 6).toLongLong();
+            *resumedAt = first;
+            reply.statusCode = 206;
+            reply.headers.append(qMakePair(QByteArray("Content-Range"),
+                                           "bytes " + QByteArray::number(first) + "-" +
+                                               QByteArray::number(blob.size() - 1) + "/" +
+                                               QByteArray::number(blob.size())));
+            reply.body = blob.mid(first);
+            return reply;
+        });
+
+        QTemporaryDir directory;
+        QString path = directory.filePath("artifact");
+        DownloadOptions options;
+        options.resume = true;
+        HttpClient client;
+        Responses responses;
+
+        client.download(server.url("/artifact"), path, responses.collect(), options);
+        QTRY_COMPARE(responses.received.size(), 1);
+        QVERIFY(!responses.received[0].ok());
+        QVERIFY(!QFile::exists(path));
+        qint64 received = QFileInfo(path + ".part").size();
+        QVERIFY(received > 0);
+        QVERIFY(received <= blob.size() / 2);
+
+        // Bytes written after the journal, as left by a crash, must not end up in the file.
+        {
+            QFile part(path + ".part");
+            QVERIFY(part.open(QIODevice::Append));
+            part.write(QByteArray(4096, 'x'));
+        }
+
+        client.download(server.url("/artifact"), path, responses.collect(), options);
+        QTRY_COMPARE(responses.received.size(), 2);
+        QVERIFY(responses.received[1].ok());
+        QCOMPARE(resumedAt->load(), received);
+        QCOMPARE(readAll(path), blob);
+        QVERIFY(!QFile::exists(path + ".part"));
+        QCOMPARE(server.requests("/artifact"), qint64(2));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestHttpClient)
+#include "tst_httpclient.moc"
@@ -0,0 +1,201 @@
+#include <QtTest>
+
+#include "httpclient/responsecache.h"
+
+using Headers = QList<QPair<QByteArray, QByteArray>>;
+
+static const QUrl url("https://api.mysite.com/api/items");
+
+static QByteArray httpDate(const QDateTime &date) {
+    return QLocale::c().toString(date.toUTC(), "ddd, dd MMM yyyy HH:mm:ss 'GMT'").toLatin1();
+}
+
+// Stores a 200 response with headers in cache and returns the entry built for it.
+static std::shared_ptr<const CacheEntry> storeAndLookup(ResponseCache *cache, const Headers &headers,
+                                                        int statusCode = 200, const QByteArray &authorization = "") {
+    Response response;
+    response.statusCode = statusCode;
+    response.body = "{\"items\":[]}";
+    response.rawHeaders = headers;
+
+    QNetworkRequest request(url);
+    if (!authorization.isEmpty()) {
+        request.setRawHeader("Authorization", authorization);
+    }
+    if (!cache->store(request, response, QDateTime::currentDateTimeUtc())) {
+        return nullptr;
+    }
+    return cache->lookup(request);
+}
+
+class TestResponseCache : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void maxAgeSetsTheLifetime() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "public, max-age=60"}});
+        QVERIFY(entry);
+        QCOMPARE(entry->freshnessLifetime, qint64(60));
+        QVERIFY(entry->isFresh(QDateTime::currentDateTimeUtc()));
+        QVERIFY(!entry->isFresh(QDateTime::currentDateTimeUtc().addSecs(61)));
+    }
+
+    void sharedMaxAgeOnlyAppliesToSharedCaches() {
+        Headers headers{{"Cache-Control", "max-age=60, s-maxage=600"}};
+
+        ResponseCache privateCache;
+        QCOMPARE(storeAndLookup(&privateCache, headers)->freshnessLifetime, qint64(60));
+
+        ResponseCache sharedCache;
+        sharedCache.setShared(true);
+        QCOMPARE(storeAndLookup(&sharedCache, headers)->freshnessLifetime, qint64(600));
+    }
+
+    void expiresIsRelativeToDate() {
+        QDateTime date = QDateTime::currentDateTimeUtc();
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Date", httpDate(date)}, {"Expires", httpDate(date.addSecs(120))}});
+        QVERIFY(entry);
+        QCOMPARE(entry->freshnessLifetime, qint64(120));
+    }
+
+    void invalidExpiresIsAlreadyExpired() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Expires", "0"}, {"ETag", "\"v1\""}});
+        QVERIFY(entry);
+        QCOMPARE(entry->freshnessLifetime, qint64(0));
+        QVERIFY(!entry->isFresh(QDateTime::currentDateTimeUtc()));
+    }
+
+    void heuristicLifetimeIsATenthOfTheLastModifiedAge() {
+        QDateTime date = QDateTime::currentDateTimeUtc();
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Date", httpDate(date)}, {"Last-Modified", httpDate(date.addDays(-5))}});
+        QVERIFY(entry);
+        QCOMPARE(entry->freshnessLifetime, qint64(5 * 24 * 60 * 60 / 10));
+
+        // At most a day.
+        entry = storeAndLookup(&cache, {{"Date", httpDate(date)}, {"Last-Modified", httpDate(date.addDays(-100))}});
+        QCOMPARE(entry->freshnessLifetime, qint64(24 * 60 * 60));
+    }
+
+    void noCacheMustBeRevalidated() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "no-cache, max-age=60"}, {"ETag", "\"v1\""}});
+        QVERIFY(entry);
+        QCOMPARE(entry->freshnessLifetime, qint64(0));
+    }
+
+    void uncacheableResponsesAreNotStored_data() {
+        QTest::addColumn<Headers>("headers");
+        QTest::addColumn<int>("statusCode");
+        QTest::newRow("no-store") << Headers{{"Cache-Control", "no-store, max-age=60"}} << 200;
+        QTest::newRow("vary *") << Headers{{"Cache-Control", "max-age=60"}, {"Vary", "*"}} << 200;
+        QTest::newRow("no lifetime or validator") << Headers{} << 200;
+        QTest::newRow("not heuristically cacheable")
+            << Headers{{"Last-Modified", httpDate(QDateTime::currentDateTimeUtc().addDays(-30))}} << 503;
+    }
+
+    void uncacheableResponsesAreNotStored() {
+        QFETCH(Headers, headers);
+        QFETCH(int, statusCode);
+        ResponseCache cache;
+        QVERIFY(!storeAndLookup(&cache, headers, statusCode));
+    }
+
+    void ageHeaderAddsToTheInitialAge() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "max-age=60"}, {"Age", "30"}});
+        QVERIFY(entry);
+        QVERIFY(entry->initialAge >= 30);
+        QVERIFY(entry->initialAge <= 31);
+        QVERIFY(entry->isFresh(QDateTime::currentDateTimeUtc()));
+        QVERIFY(!entry->isFresh(QDateTime::currentDateTimeUtc().addSecs(31)));
+    }
+
+    void apparentAgeComesFromDate() {
+        ResponseCache cache;
+        QByteArray date = httpDate(QDateTime::currentDateTimeUtc().addSecs(-100));
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "max-age=60"}, {"Date", date}});
+        QVERIFY(entry);
+        QVERIFY(entry->initialAge >= 99);
+        QVERIFY(entry->initialAge <= 101);
+        QVERIFY(!entry->isFresh(QDateTime::currentDateTimeUtc()));
+    }
+
+    void ageGrowsWithResidentTime() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "max-age=60"}, {"Age", "30"}});
+        QVERIFY(entry);
+        QCOMPARE(entry->age(entry->responseTime.addSecs(10)), entry->initialAge + 10);
+        QCOMPARE(entry->age(entry->responseTime.addSecs(-10)), entry->initialAge);
+    }
+
+    void responsesAreNotSharedAcrossCredentials() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(&cache, {{"Cache-Control", "max-age=60"}, {"Vary", "Authorization"}}, 200,
+                                    "Bearer alice");
+        QVERIFY(entry);
+        QVERIFY(!entry->credential.contains("alice"));
+        QVERIFY(entry->varyHeaders.isEmpty());
+
+        QNetworkRequest request(url);
+        QVERIFY(!cache.lookup(request));
+        request.setRawHeader("Authorization", "Bearer bob");
+        QVERIFY(!cache.lookup(request));
+        request.setRawHeader("Authorization", "Bearer alice");
+        QVERIFY(cache.lookup(request));
+    }
+
+    void staleWindowsExtendTheLifetime() {
+        ResponseCache cache;
+        auto entry =
+            storeAndLookup(&cache, {{"Cache-Control", "max-age=10, stale-while-revalidate=20, stale-if-error=300"}});
+        QVERIFY(entry);
+        QDateTime later = entry->responseTime.addSecs(25);
+        QVERIFY(!entry->isFresh(later));
+        QVERIFY(entry->isUsableWhileRevalidating(later));
+        QVERIFY(entry->isUsableOnError(later));
+        QVERIFY(!entry->isUsableWhileRevalidating(entry->responseTime.addSecs(31)));
+    }
+
+    void noCacheIsNeverServedStale() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(
+            &cache, {{"Cache-Control", "no-cache, stale-while-revalidate=60, stale-if-error=60"}, {"ETag", "\"v1\""}});
+        QVERIFY(entry);
+        QCOMPARE(entry->staleWhileRevalidate, qint64(0));
+        QCOMPARE(entry->staleIfError, qint64(0));
+        QVERIFY(!entry->isUsableWhileRevalidating(entry->responseTime));
+        QVERIFY(!entry->isUsableOnError(entry->responseTime));
+    }
+
+    void mustRevalidateIsNeverServedStale() {
+        ResponseCache cache;
+        auto entry = storeAndLookup(
+            &cache, {{"Cache-Control", "max-age=10, must-revalidate, stale-while-revalidate=60, stale-if-error=60"}});
+        QVERIFY(entry);
+        QDateTime later = entry->responseTime.addSecs(20);
+        QVERIFY(!entry->isUsableWhileRevalidating(later));
+        QVERIFY(!entry->isUsableOnError(later));
+    }
+
+    void proxyRevalidateOnlyBindsSharedCaches() {
+        Headers headers{{"Cache-Control", "max-age=10, proxy-revalidate, stale-if-error=60"}};
+
+        ResponseCache privateCache;
+        auto entry = storeAndLookup(&privateCache, headers);
+        QVERIFY(entry);
+        QVERIFY(entry->isUsableOnError(entry->responseTime.addSecs(20)));
+
+        ResponseCache sharedCache;
+        sharedCache.setShared(true);
+        entry = storeAndLookup(&sharedCache, headers);
+        QVERIFY(entry);
+        QVERIFY(!entry->isUsableOnError(entry->responseTime.addSecs(20)));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestResponseCache)
+#include "tst_responsecache.moc"
@@ -0,0 +1,106 @@
+#include <QtTest>
+
+#include "httpclient/retrypolicy.h"
+
+using std::chrono::milliseconds;
+
+static Response withRetryAfter(const QByteArray &value) {
+    Response response;
+    response.statusCode = 503;
+    response.rawHeaders.append(qMakePair(QByteArray("Retry-After"), value));
+    return response;
+}
+
+static QByteArray httpDate(const QDateTime &date) {
+    return QLocale::c().toString(date.toUTC(), "ddd, dd MMM yyyy HH:mm:ss 'GMT'").toLatin1();
+}
+
+class TestRetryPolicy : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void retryAfterReadsSeconds() {
+        QCOMPARE(RetryPolicy::retryAfter(withRetryAfter("120")), milliseconds(120000));
+        QCOMPARE(RetryPolicy::retryAfter(withRetryAfter(" 0 ")), milliseconds(0));
+    }
+
+    void retryAfterReadsHttpDates() {
+        milliseconds future = RetryPolicy::retryAfter(withRetryAfter(httpDate(QDateTime::currentDateTimeUtc().addSecs(30))));
+        QVERIFY(future > milliseconds(28000));
+        QVERIFY(future <= milliseconds(30000));
+
+        // A date in the past asks for an immediate retry.
+        QCOMPARE(RetryPolicy::retryAfter(withRetryAfter(httpDate(QDateTime::currentDateTimeUtc().addSecs(-30)))),
+                 milliseconds(0));
+    }
+
+    void retryAfterRejectsInvalidValues_data() {
+        QTest::addColumn<QByteArray>("value");
+        QTest::newRow("negative") << QByteArray("-5");
+        QTest::newRow("text") << QByteArray("soon");
+        QTest::newRow("blank") << QByteArray("  ");
+    }
+
+    void retryAfterRejectsInvalidValues() {
+        QFETCH(QByteArray, value);
+        QVERIFY(RetryPolicy::retryAfter(withRetryAfter(value)) < milliseconds(0));
+    }
+
+    void retryAfterWithoutHeader() {
+        QVERIFY(RetryPolicy::retryAfter(Response()) < milliseconds(0));
+    }
+
+    void backoffStaysWithinTheDoublingCeiling() {
+        RetryPolicy policy;
+        policy.baseDelay = milliseconds(100);
+        policy.maxDelay = milliseconds(1000);
+
+        Response failure;
+        failure.statusCode = 503;
+        const qint64 ceilings[] = {100, 200, 400, 800, 1000, 1000};
+        for (int retry = 1; retry <= 6; retry++) {
+            for (int sample = 0; sample < 200; sample++) {
+                milliseconds delay = policy.backoff(retry, failure);
+                QVERIFY(delay >= milliseconds(0));
+                QVERIFY(delay <= milliseconds(ceilings[retry - 1]));
+            }
+        }
+    }
+
+    void backoffIsJittered() {
+        RetryPolicy policy;
+        policy.baseDelay = milliseconds(1000);
+        policy.maxDelay = milliseconds(1000);
+
+        QSet<qint64> delays;
+        for (int sample = 0; sample < 50; sample++) {
+            delays.insert(policy.backoff(1, Response()).count());
+        }
+        QVERIFY(delays.size() > 1);
+    }
+
+    void backoffDoesNotOverflow() {
+        RetryPolicy policy;
+        policy.baseDelay = milliseconds(100);
+        policy.maxDelay = milliseconds(5000);
+
+        for (int retry : {31, 64, 1000}) {
+            milliseconds delay = policy.backoff(retry, Response());
+            QVERIFY(delay >= milliseconds(0));
+            QVERIFY(delay <= policy.maxDelay);
+        }
+    }
+
+    void backoffFollowsRetryAfter() {
+        RetryPolicy policy;
+        policy.maxDelay = milliseconds(10000);
+        QCOMPARE(policy.backoff(1, withRetryAfter("3")), milliseconds(3000));
+        QCOMPARE(policy.backoff(5, withRetryAfter("10")), milliseconds(10000));
+
+        // Waiting longer than maxDelay gives up on the request.
+        QVERIFY(policy.backoff(1, withRetryAfter("11")) < milliseconds(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRetryPolicy)
+#include "tst_retrypolicy.moc"
@@ -0,0 +1,129 @@
+#include <QtTest>
+
+#include "httpclient/httpclient.h"
+#include "httpclient/tlssessioncache.h"
+
+static const QByteArray secret = QByteArray("0123456789abcdef0123456789abcdef");
+static const QByteArray ticket = QByteArray("session-ticket-of-api.mysite.com");
+static const QString host = "api.mysite.com:443";
+
+static QByteArray readAll(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+class TestTlsSessionCache : public QObject {
+    Q_OBJECT
+
+   private slots:
+    void keepsTicketsInMemory() {
+        TlsSessionCache cache;
+        QVERIFY(cache.ticket(host).isEmpty());
+        cache.store(host, ticket, 0);
+        QCOMPARE(cache.ticket(host), ticket);
+        cache.remove(host);
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+
+    void ticketsExpire() {
+        TlsSessionCache cache;
+        cache.store(host, ticket, 1);
+        QCOMPARE(cache.ticket(host), ticket);
+        QTest::qWait(1100);
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+
+    void sealedFileReopensWithTheSameSecret() {
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        {
+            TlsSessionCache cache(path, secret);
+            cache.store(host, ticket, 0);
+            cache.store("cdn.mysite.com:443", "other-ticket", 0);
+        }
+
+        TlsSessionCache cache(path, secret);
+        QCOMPARE(cache.ticket(host), ticket);
+        QCOMPARE(cache.ticket("cdn.mysite.com:443"), QByteArray("other-ticket"));
+    }
+
+    void sealedFileIsEncrypted() {
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        TlsSessionCache cache(path, secret);
+        cache.store(host, ticket, 0);
+
+        QByteArray sealed = readAll(path);
+        QVERIFY(!sealed.isEmpty());
+        QVERIFY(!sealed.contains(ticket));
+        QVERIFY(!sealed.contains(ticket.toBase64()));
+        QVERIFY(!sealed.contains(host.toLatin1()));
+
+        // A fresh nonce seals each write differently.
+        cache.store(host, "rotated-ticket", 0);
+        cache.store(host, ticket, 0);
+        QVERIFY(readAll(path) != sealed);
+    }
+
+    void otherSecretCanNotOpenTheFile() {
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        {
+            TlsSessionCache cache(path, secret);
+            cache.store(host, ticket, 0);
+        }
+
+        TlsSessionCache cache(path, QByteArray("another secret of at least 32 bytes"));
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+
+    void tamperedFileIsIgnored_data() {
+        QTest::addColumn<int>("offset");
+        QTest::newRow("nonce") << 0;
+        QTest::newRow("ciphertext") << 20;
+        QTest::newRow("tag") << -1;
+    }
+
+    void tamperedFileIsIgnored() {
+        QFETCH(int, offset);
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        {
+            TlsSessionCache cache(path, secret);
+            cache.store(host, ticket, 0);
+        }
+
+        QByteArray sealed = readAll(path);
+        qsizetype at = offset >= 0 ? offset : sealed.size() + offset;
+        sealed[at] = char(sealed.at(at) ^ 0x01);
+        writeFile(path, sealed);
+
+        TlsSessionCache cache(path, secret);
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+
+    void truncatedFileIsIgnored() {
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        writeFile(path, "short");
+
+        TlsSessionCache cache(path, secret);
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+
+    void removalIsPersisted() {
+        QTemporaryDir directory;
+        QString path = directory.filePath("sessions");
+        {
+            TlsSessionCache cache(path, secret);
+            cache.store(host, ticket, 0);
+            cache.remove(host);
+        }
+
+        TlsSessionCache cache(path, secret);
+        QVERIFY(cache.ticket(host).isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTlsSessionCache)
+#include "tst_tlssessioncache.moc"
@@ -0,0 +1,83 @@
+#include "httpclient/tlsprofile.h"
+
+#include <QFile>
+#include <QSslCertificate>
+#include <QSslCipher>
+#include <QSslKey>
+
+// Reads the certificates of a PEM file. Returns false and sets error if there is none.
+static bool readCertificates(const QString &path, QList<QSslCertificate> *certificates, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Unable to read %1: %2").arg(path).arg(file.errorString());
+        return false;
+    }
+    *certificates = QSslCertificate::fromData(file.readAll(), QSsl::Pem);
+    if (certificates->isEmpty()) {
+        *error = QString("No certificate in %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+QSslConfiguration TlsProfile::toSslConfiguration(QString *error) const {
+    QString reason;
+    if (!error) {
+        error = &reason;
+    }
+
+    // Setting or adding CA certificates turns off the on-demand loading of the system CAs, so
+    // they are listed explicitly when they are trusted next to a bundle.
+    QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+    if (!systemCaCertificates) {
+        configuration.setCaCertificates(QList<QSslCertificate>());
+    } else if (!caBundle.isEmpty()) {
+        configuration.addCaCertificates(QSslConfiguration::systemCaCertificates());
+    }
+    if (!caBundle.isEmpty()) {
+        QList<QSslCertificate> authorities;
+        if (!readCertificates(caBundle, &authorities, error)) {
+            return QSslConfiguration();
+        }
+        configuration.addCaCertificates(authorities);
+    }
+
+    if (!certificate.isEmpty()) {
+        QList<QSslCertificate> chain;
+        if (!readCertificates(certificate, &chain, error)) {
+            return QSslConfiguration();
+        }
+        configuration.setLocalCertificateChain(chain);
+
+        QFile file(privateKey);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = QString("Unable to read %1: %2").arg(privateKey).arg(file.errorString());
+            return QSslConfiguration();
+        }
+        QByteArray pem = file.readAll();
+        QSslKey key(pem, QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey, passphrase);
+        if (key.isNull()) {
+            key = QSslKey(pem, QSsl::Ec, QSsl::Pem, QSsl::PrivateKey, passphrase);
+        }
+        if (key.isNull()) {
+            *error = QString("No private key in %1").arg(privateKey);
+            return QSslConfiguration();
+        }
+        configuration.setPrivateKey(key);
+    }
+
+    configuration.setProtocol(protocol);
+    if (!ciphers.isEmpty()) {
+        QList<QSslCipher> suites;
+        for (const QString &name : ciphers) {
+            QSslCipher cipher(name);
+            if (cipher.isNull()) {
+                *error = QString("Unsupported cipher %1").arg(name);
+                return QSslConfiguration();
+            }
+            suites.append(cipher);
+        }
+        configuration.setCiphers(suites);
+    }
+    return configuration;
+}
@@ -0,0 +1,174 @@
+#include "httpclient/tlssessioncache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QSaveFile>
+
+// Lifetime of a ticket whose server did not send a lifetime hint.
+static constexpr qint64 defaultLifetime = 2 * 60 * 60;
+
+static constexpr qsizetype nonceSize = 16;
+static constexpr qsizetype tagSize = 32;
+
+// Compares two MACs in constant time.
+static bool equalTags(const QByteArray &a, const QByteArray &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    char difference = 0;
+    for (qsizetype i = 0; i < a.size(); i++) {
+        difference |= a.at(i) ^ b.at(i);
+    }
+    return difference == 0;
+}
+
+TlsSessionCache::TlsSessionCache() {}
+
+TlsSessionCache::TlsSessionCache(const QString &path, const QByteArray &secret)
+    : path(path),
+      encryptionKey(QMessageAuthenticationCode::hash("tls session encryption", secret, QCryptographicHash::Sha256)),
+      authenticationKey(
+          QMessageAuthenticationCode::hash("tls session authentication", secret, QCryptographicHash::Sha256)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    load();
+}
+
+QByteArray TlsSessionCache::ticket(const QString &host) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto session = sessions.constFind(host);
+    if (session == sessions.constEnd() || session->expires <= QDateTime::currentMSecsSinceEpoch()) {
+        return QByteArray();
+    }
+    return session->ticket;
+}
+
+void TlsSessionCache::store(const QString &host, const QByteArray &ticket, int lifetimeHint) {
+    Session session;
+    session.ticket = ticket;
+    session.expires = QDateTime::currentMSecsSinceEpoch() + (lifetimeHint > 0 ? lifetimeHint : defaultLifetime) * 1000;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto stored = sessions.constFind(host);
+    if (stored != sessions.constEnd() && stored->ticket == ticket) {
+        return;
+    }
+    sessions.insert(host, session);
+    write();
+}
+
+void TlsSessionCache::remove(const QString &host) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sessions.remove(host) > 0) {
+        write();
+    }
+}
+
+void TlsSessionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions.clear();
+    write();
+}
+
+void TlsSessionCache::recordHandshake(bool resumed, qint64 nsecs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (resumed) {
+        stats.resumed++;
+        stats.resumedNsecs += nsecs;
+    } else {
+        stats.full++;
+        stats.fullNsecs += nsecs;
+    }
+}
+
+TlsHandshakeStats TlsSessionCache::handshakeStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void TlsSessionCache::load() {
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // nonce | ciphertext | tag
+    QByteArray sealed = file.readAll();
+    if (sealed.size() < nonceSize + tagSize) {
+        return;
+    }
+    QByteArray nonce = sealed.left(nonceSize);
+    QByteArray ciphertext = sealed.mid(nonceSize, sealed.size() - nonceSize - tagSize);
+    QByteArray tag = sealed.right(tagSize);
+    if (!equalTags(tag, QMessageAuthenticationCode::hash(nonce + ciphertext, authenticationKey,
+                                                         QCryptographicHash::Sha256))) {
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonArray array = QJsonDocument::fromJson(applyKeystream(nonce, ciphertext)).object().value("sessions").toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        Session session;
+        session.ticket = QByteArray::fromBase64(object.value("ticket").toString().toLatin1());
+        session.expires = object.value("expires").toInteger();
+        if (!session.ticket.isEmpty() && session.expires > now) {
+            sessions.insert(object.value("host").toString(), session);
+        }
+    }
+}
+
+void TlsSessionCache::write() const {
+    if (path.isEmpty()) {
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonArray array;
+    for (auto session = sessions.cbegin(); session != sessions.cend(); ++session) {
+        if (session->expires <= now) {
+            continue;
+        }
+        QJsonObject object;
+        object.insert("host", session.key());
+        object.insert("ticket", QString::fromLatin1(session->ticket.toBase64()));
+        object.insert("expires", session->expires);
+        array.append(object);
+    }
+    QJsonObject root;
+    root.insert("sessions", array);
+
+    quint32 random[nonceSize / sizeof(quint32)];
+    QRandomGenerator::system()->fillRange(random);
+    QByteArray nonce(reinterpret_cast<const char *>(random), nonceSize);
+    QByteArray ciphertext = applyKeystream(nonce, QJsonDocument(root).toJson(QJsonDocument::Compact));
+    QByteArray tag = QMessageAuthenticationCode::hash(nonce + ciphertext, authenticationKey, QCryptographicHash::Sha256);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(nonce + ciphertext + tag);
+    file.commit();
+}
+
+QByteArray TlsSessionCache::applyKeystream(const QByteArray &nonce, const QByteArray &data) const {
+    QByteArray result = data;
+    quint64 counter = 0;
+    for (qsizetype offset = 0; offset < result.size(); counter++) {
+        QByteArray block = nonce;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            block.append(char(counter >> shift));
+        }
+        QByteArray pad = QMessageAuthenticationCode::hash(block, encryptionKey, QCryptographicHash::Sha256);
+        for (qsizetype i = 0; i < pad.size() && offset < result.size(); i++, offset++) {
+            result[offset] = result.at(offset) ^ pad.at(i);
+        }
+    }
+    return result;
+}